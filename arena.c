@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#define CHECKERS_NO_MAIN // rules + search out of checkers.c, our own main()
+#include "checkers.c"
+
+/**
+ * Self-play arena - plays lots of games between two engine setups (A and B) with no board printing
+ * and no input, and says which one is stronger
+ *
+ * Usage: ./arena [-n games] [-w workers] [-s seed] [-r random_plies] [-a spec] [-b spec] [-o file]
+ *   spec = comma separated settings for that engine, e.g. "depth=8" or "ms=100,mb=32,threads=2"
+ *          depth (default 6), ms (0 = no time limit), mb = table size (default 16), threads (default 1)
+ *          playouts=N (or mcts=1 with ms) plays with MCTS instead of alpha-beta, mb is its node pool
+ *   -n games (default 1000), -w workers = games played at once (default every core),
+ *   -s seed (default 1), -r random_plies (default 4), -o file = one CSV line per game
+ *
+ * Games come in pairs: the first few plies of both games are random moves picked from the seed
+ * (so the same seed = the same openings), and A plays red in one game and black in the other.
+ * That way neither engine gets the better side of an opening more often
+ *
+ * A game is a draw after three times the same position, ARENA_QUIET_PLIES plies without a capture
+ * or a man moving, or ARENA_MAX_PLIES plies total. Each worker owns two Engines (its own tables)
+ * and two MCTS trees, so the games never share anything and don't get in each other's way
+ */
+
+#define ARENA_MAX_PLIES 400
+#define ARENA_QUIET_PLIES 80    // 40 moves each with only kings shuffling around = draw
+
+enum { END_NO_MOVES, END_REPETITION, END_QUIET, END_LENGTH };
+static const char *const end_names[] = {"no moves", "repetition", "40 move rule", "max length"};
+
+typedef struct {
+    SearchLimits limits;
+    int mb;             // table size (node pool for MCTS)
+    int mcts;           // 1 = MCTS with 'playouts' / limits.time_ms instead of alpha-beta
+    int playouts;
+} EngineConfig;
+
+typedef struct {
+    int result;             // from A's side: 1 = A won, 0 = draw, -1 = B won
+    int end;                // END_*
+    int plies;
+    uint64_t nodes[2];      // searched by A / B
+    double seconds[2];
+} GameRecord;
+
+static EngineConfig configs[2];
+static int total_games = 1000, random_plies = 4;
+static uint64_t arena_seed = 1;
+static FILE *csv = NULL;
+
+static int next_game = 0;   // handed out to workers with an atomic add
+static pthread_mutex_t results_lock = PTHREAD_MUTEX_INITIALIZER;
+static int finished = 0, wins = 0, draws = 0, losses = 0;
+static int end_counts[4];
+static uint64_t total_plies = 0, total_nodes[2];
+static double total_seconds[2];
+
+/**
+ * Parse "depth=8,ms=100,..." into 'c'
+ * Returns 0 on anything it doesn't understand
+ */
+static int parse_config(const char *spec, EngineConfig *c) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        char *eq = strchr(tok, '=');
+        if (!eq) return 0;
+        *eq = '\0';
+        int v = atoi(eq + 1);
+        if (strcmp(tok, "depth") == 0) c->limits.max_depth = v;
+        else if (strcmp(tok, "ms") == 0) c->limits.time_ms = v;
+        else if (strcmp(tok, "mb") == 0) c->mb = v;
+        else if (strcmp(tok, "threads") == 0) c->limits.threads = v;
+        else if (strcmp(tok, "mcts") == 0) c->mcts = v != 0;
+        else if (strcmp(tok, "playouts") == 0) { c->playouts = v; c->mcts = 1; }
+        else return 0;
+    }
+    if (c->mcts) return c->mb > 0 && (c->playouts > 0 || c->limits.time_ms > 0);
+    return c->mb > 0 && (c->limits.max_depth > 0 || c->limits.time_ms > 0); // Error catch - has to stop somehow
+}
+
+static void print_config(const char *name, const EngineConfig *c) {
+    if (c->mcts)
+        printf("%s: MCTS, %d playouts, %d ms, %d MB pool, %d thread%s\n", name, c->playouts, c->limits.time_ms,
+               c->mb, c->limits.threads, c->limits.threads == 1 ? "" : "s");
+    else
+        printf("%s: depth %d, %d ms, %d MB table, %d thread%s\n", name, c->limits.max_depth, c->limits.time_ms,
+               c->mb, c->limits.threads, c->limits.threads == 1 ? "" : "s");
+}
+
+/**
+ * Play game number 'game' to the end, engines[0] / trees[0] are A's and engines[1] / trees[1] B's
+ * Even games A plays red, odd games black, and both games of a pair get the same random opening
+ */
+static void play_arena_game(int game, Engine *engines, MctsTree *trees, GameRecord *rec) {
+    memset(rec, 0, sizeof(*rec));
+    GameState g;
+    init_board(&g);
+    int a_turn = game & 1; // turn value A moves on
+    uint64_t rng = arena_seed * 0x9E3779B97F4A7C15ULL + (uint64_t)(game / 2);
+    tt_clear(&engines[0].tt); // no leftovers from the last game
+    tt_clear(&engines[1].tt);
+
+    static _Thread_local uint64_t seen[ARENA_MAX_PLIES + 1]; // hash after every ply, for repetitions
+    seen[0] = g.hash;
+    int quiet = 0;
+
+    for (int ply = 0; ; ) {
+        MoveList list;
+        generate_moves(&g, &list);
+        if (list.count == 0) { // side to move lost
+            rec->result = g.turn == a_turn ? -1 : 1;
+            rec->end = END_NO_MOVES;
+            break;
+        }
+
+        Move m;
+        if (ply < random_plies) {
+            m = list.moves[splitmix64(&rng) % (uint64_t)list.count];
+        } else {
+            int side = g.turn == a_turn ? 0 : 1;
+            if (configs[side].mcts) { // playouts count as the nodes
+                MctsLimits ml = {configs[side].playouts, configs[side].limits.time_ms, configs[side].limits.threads};
+                MctsResult r = mcts_search(&trees[side], &g, ml);
+                m = r.best;
+                rec->nodes[side] += r.playouts;
+                rec->seconds[side] += r.seconds;
+            } else {
+                SearchResult r = engine_search(&engines[side], &g, configs[side].limits);
+                m = r.best;
+                rec->nodes[side] += r.nodes;
+                rec->seconds[side] += r.seconds;
+            }
+        }
+
+        uint64_t men = g.turn == 0 ? g.red : g.black;
+        quiet = m.captures || (men & (1ULL << m.from)) ? 0 : quiet + 1; // captures and men moving can't be undone
+        apply_move(&g, &m);
+        switch_turn(&g);
+        seen[++ply] = g.hash;
+        rec->plies = ply;
+
+        // same position (same side to move) can only come back since the last capture / man move
+        int repeats = 1;
+        for (int back = 2; back <= quiet; back += 2)
+            if (seen[ply - back] == g.hash) repeats++;
+        if (repeats >= 3) { rec->end = END_REPETITION; break; }
+        if (quiet >= ARENA_QUIET_PLIES) { rec->end = END_QUIET; break; }
+        if (ply >= ARENA_MAX_PLIES) { rec->end = END_LENGTH; break; }
+    }
+}
+
+static void *arena_worker(void *arg) {
+    (void)arg;
+    Engine engines[2];
+    MctsTree trees[2];
+    memset(engines, 0, sizeof(engines));
+    memset(trees, 0, sizeof(trees));
+    int ok = 1;
+    for (int s = 0; s < 2; s++)
+        ok &= configs[s].mcts ? mcts_alloc(&trees[s], configs[s].mb) : tt_alloc(&engines[s].tt, configs[s].mb);
+    if (!ok) {
+        fprintf(stderr, "Out of memory for the tables.\n"); // Error catch - this worker sits out
+        for (int s = 0; s < 2; s++) { engine_free(&engines[s]); mcts_free(&trees[s]); }
+        return NULL;
+    }
+
+    while (1) {
+        int game = __atomic_fetch_add(&next_game, 1, __ATOMIC_RELAXED);
+        if (game >= total_games) break;
+        GameRecord rec;
+        play_arena_game(game, engines, trees, &rec);
+
+        pthread_mutex_lock(&results_lock);
+        finished++;
+        if (rec.result > 0) wins++;
+        else if (rec.result < 0) losses++;
+        else draws++;
+        end_counts[rec.end]++;
+        total_plies += (uint64_t)rec.plies;
+        for (int s = 0; s < 2; s++) { total_nodes[s] += rec.nodes[s]; total_seconds[s] += rec.seconds[s]; }
+        if (csv)
+            fprintf(csv, "%d,%s,%d,%d,%s,%llu,%llu\n", game, game & 1 ? "black" : "red", rec.result, rec.plies,
+                    end_names[rec.end], (unsigned long long)rec.nodes[0], (unsigned long long)rec.nodes[1]);
+        fprintf(stderr, "\r%d/%d games  +%d =%d -%d", finished, total_games, wins, draws, losses);
+        pthread_mutex_unlock(&results_lock);
+    }
+    for (int s = 0; s < 2; s++) { engine_free(&engines[s]); mcts_free(&trees[s]); }
+    return NULL;
+}
+
+// Score fraction -> Elo difference (0 and 1 are infinite, clamp them)
+static double elo(double score) {
+    if (score <= 0.0005) score = 0.0005;
+    if (score >= 0.9995) score = 0.9995;
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+/**
+ * Win/draw/loss summary from A's side
+ * The 95% interval uses the spread of the actual per-game scores (1, 0.5, 0), so lots of draws
+ * correctly make it narrower than counting wins and losses alone would
+ * LOS = likelihood of superiority, the chance A really is stronger given the wins and losses
+ */
+static void print_summary(void) {
+    int n = wins + draws + losses;
+    if (n == 0) { printf("No games finished.\n"); return; }
+    double score = (wins + 0.5 * draws) / n;
+    double var = (wins * (1 - score) * (1 - score) + draws * (0.5 - score) * (0.5 - score)
+                + losses * score * score) / n;
+    double margin = 1.96 * sqrt(var / n);
+    double los = wins + losses > 0 ? 0.5 * (1 + erf((wins - losses) / sqrt(2.0 * (wins + losses)))) : 0.5;
+
+    printf("\n\nGames: %d   A wins %d, draws %d, B wins %d\n", n, wins, draws, losses);
+    printf("A score: %.1f%% +/- %.1f%%  (95%% confidence)\n", 100 * score, 100 * margin);
+    printf("Elo difference: %+.1f  (95%% interval %+.1f to %+.1f)   LOS %.1f%%\n",
+           elo(score), elo(score - margin), elo(score + margin), 100 * los);
+    printf("Average length: %.1f plies   ended by:", (double)total_plies / n);
+    for (int e = 0; e < 4; e++) printf(" %s %d%s", end_names[e], end_counts[e], e < 3 ? "," : "\n");
+    for (int s = 0; s < 2; s++)
+        printf("%s: %.0f %s/s (%.1f s searching)\n", s == 0 ? "A" : "B",
+               total_seconds[s] > 0 ? total_nodes[s] / total_seconds[s] : 0.0, configs[s].mcts ? "playouts" : "nodes",
+               total_seconds[s]);
+}
+
+int main(int argc, char **argv) {
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *out = NULL;
+    for (int i = 0; i < 2; i++) configs[i] = (EngineConfig){{6, 0, 1}, 16, 0, 0};
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0) total_games = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-w") == 0) workers = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-s") == 0) arena_seed = strtoull(argv[i + 1], NULL, 0);
+        else if (strcmp(argv[i], "-r") == 0) random_plies = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-o") == 0) out = argv[i + 1];
+        else if (strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "-b") == 0) {
+            int which = argv[i][1] == 'a' ? 0 : 1;
+            configs[which] = (EngineConfig){{0, 0, 1}, 16, 0, 0}; // only what's in the spec counts
+            if (!parse_config(argv[i + 1], &configs[which])) { printf("Bad engine spec: %s\n", argv[i + 1]); return 1; }
+        }
+    }
+    if (total_games < 1) total_games = 1;
+    if (workers < 1) workers = 1;
+    if (workers > total_games) workers = total_games;
+    if (random_plies < 0) random_plies = 0;
+
+    GameState g;
+    init_board(&g); // sets up the zobrist keys before any worker needs them
+    if (tb_open(TB_DEFAULT_FILE)) printf("Endgame tablebase loaded (up to %d pieces).\n", tb.max_pieces);
+    if (out && !(csv = fopen(out, "w"))) { printf("Can't write %s\n", out); return 1; }
+    if (csv) fprintf(csv, "game,a_color,result,plies,end,a_nodes,b_nodes\n");
+
+    print_config("A", &configs[0]);
+    print_config("B", &configs[1]);
+    printf("%d games, %d workers, seed %llu, %d random plies\n", total_games, workers,
+           (unsigned long long)arena_seed, random_plies);
+
+    pthread_t *ids = malloc(workers * sizeof(pthread_t));
+    if (!ids) { printf("Out of memory.\n"); return 1; }
+    int started = 0;
+    for (int w = 0; w < workers; w++, started++)
+        if (pthread_create(&ids[w], NULL, arena_worker, NULL) != 0) break;
+    if (started == 0) arena_worker(NULL); // Error catch - no threads at all, play them here
+    for (int w = 0; w < started; w++) pthread_join(ids[w], NULL);
+    free(ids);
+
+    if (csv) fclose(csv);
+    print_summary();
+    return 0;
+}
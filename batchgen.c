@@ -0,0 +1,254 @@
+/**
+ * Batched move generation - the shift/mask trick from generate_moves() run over a whole array
+ * of positions at once
+ *
+ * Included from checkers.c after movegen.c (uses its column masks)
+ *
+ * Positions come in "structure of arrays" form: one array per bitboard plus one for the turn,
+ * so board i is red[i], black[i], red_kings[i], black_kings[i], turn[i]. That layout lets one
+ * AVX2 register hold the same board from 4 positions (8 with AVX-512), and since finding moves
+ * with shifts has no branches at all, every instruction just does 4 or 8 positions at a time
+ *
+ * For each position we hand back:
+ *   movers[i]  - pieces of the side to move that have a simple step
+ *   jumpers[i] - pieces of the side to move that have a jump
+ *   counts[i]  - first jump hops if the side has any (captures are forced), otherwise simple
+ *                steps - the same as generate_moves() gives whenever no jump can carry on into a
+ *                multi-jump
+ *
+ * The best instruction set the CPU has gets picked on the first call, the leftover positions at
+ * the end of the array (and CPUs without AVX2) go through the plain scalar version
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_X86 1
+#else
+#define BATCH_X86 0
+#endif
+
+/**
+ * One position, plain C - this is the reference the SIMD versions have to match
+ * The turn becomes a mask (all 1s for black, all 0s for red) so picking the side's boards is
+ * just AND/OR instead of an if
+ */
+static void batch_one(uint64_t red, uint64_t black, uint64_t red_kings, uint64_t black_kings, int turn,
+                      uint64_t *movers, uint64_t *jumpers, uint16_t *count) {
+    uint64_t t = 0 - (uint64_t)(turn != 0);
+    uint64_t men = (red & ~t) | (black & t);
+    uint64_t kings = (red_kings & ~t) | (black_kings & t);
+    uint64_t enemy = ((black | black_kings) & ~t) | ((red | red_kings) & t);
+    uint64_t empty = ~(red | black | red_kings | black_kings);
+    uint64_t up = kings | (men & ~t);   // pieces allowed to go up the board (red men + all kings)
+    uint64_t down = kings | (men & t);  // pieces allowed to go down (black men + all kings)
+
+    uint64_t s9 = ((up & NOT_COL_7) << 9) & empty, s7 = ((up & NOT_COL_0) << 7) & empty;
+    uint64_t sm7 = ((down & NOT_COL_7) >> 7) & empty, sm9 = ((down & NOT_COL_0) >> 9) & empty;
+
+    uint64_t j9 = ((((up & NOT_COL_67) << 9) & enemy) << 9) & empty;
+    uint64_t j7 = ((((up & NOT_COL_01) << 7) & enemy) << 7) & empty;
+    uint64_t jm7 = ((((down & NOT_COL_67) >> 7) & enemy) >> 7) & empty;
+    uint64_t jm9 = ((((down & NOT_COL_01) >> 9) & enemy) >> 9) & empty;
+
+    *movers = (s9 >> 9) | (s7 >> 7) | (sm7 << 7) | (sm9 << 9); // shift the targets back to where they came from
+    *jumpers = (j9 >> 18) | (j7 >> 14) | (jm7 << 14) | (jm9 << 18);
+    int jumps = popcount(j9) + popcount(j7) + popcount(jm7) + popcount(jm9);
+    int steps = popcount(s9) + popcount(s7) + popcount(sm7) + popcount(sm9);
+    *count = (uint16_t)(jumps ? jumps : steps);
+}
+
+static void batch_scalar(const uint64_t *red, const uint64_t *black, const uint64_t *red_kings,
+                         const uint64_t *black_kings, const uint8_t *turn, size_t n,
+                         uint64_t *movers, uint64_t *jumpers, uint16_t *counts) {
+    for (size_t i = 0; i < n; i++)
+        batch_one(red[i], black[i], red_kings[i], black_kings[i], turn[i], &movers[i], &jumpers[i], &counts[i]);
+}
+
+#if BATCH_X86
+
+/**
+ * AVX2 - 4 positions per step
+ * There's no 64 bit popcount in AVX2, so the counts use the nibble table trick: look up the bit
+ * count of every 4 bit chunk with a byte shuffle, add all 8 target boards together byte by byte
+ * (at most 8 per byte per board, so 64 max, no overflow), then sum each lane's bytes with SAD
+ */
+#define AVX2_SHIFT(v, d) ((d) > 0 ? _mm256_slli_epi64(v, (d)) : _mm256_srli_epi64(v, -(d)))
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_byte_popcount(__m256i v) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(v, low));
+    __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+    return _mm256_add_epi8(lo, hi);
+}
+
+__attribute__((target("avx2")))
+static size_t batch_avx2(const uint64_t *red, const uint64_t *black, const uint64_t *red_kings,
+                         const uint64_t *black_kings, const uint8_t *turn, size_t n,
+                         uint64_t *movers, uint64_t *jumpers, uint16_t *counts) {
+    const __m256i c0 = _mm256_set1_epi64x((long long)NOT_COL_0), c7 = _mm256_set1_epi64x((long long)NOT_COL_7);
+    const __m256i c01 = _mm256_set1_epi64x((long long)NOT_COL_01), c67 = _mm256_set1_epi64x((long long)NOT_COL_67);
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i r = _mm256_loadu_si256((const __m256i *)(red + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(black + i));
+        __m256i rk = _mm256_loadu_si256((const __m256i *)(red_kings + i));
+        __m256i bk = _mm256_loadu_si256((const __m256i *)(black_kings + i));
+
+        int32_t tb; memcpy(&tb, turn + i, 4); // 4 turn bytes -> 4 lanes of all 0s / all 1s
+        __m256i t = _mm256_cmpgt_epi64(_mm256_cvtepu8_epi64(_mm_cvtsi32_si128(tb)), zero);
+
+        __m256i men = _mm256_or_si256(_mm256_andnot_si256(t, r), _mm256_and_si256(t, b));
+        __m256i kings = _mm256_or_si256(_mm256_andnot_si256(t, rk), _mm256_and_si256(t, bk));
+        __m256i enemy = _mm256_or_si256(_mm256_andnot_si256(t, _mm256_or_si256(b, bk)),
+                                        _mm256_and_si256(t, _mm256_or_si256(r, rk)));
+        __m256i empty = _mm256_andnot_si256(_mm256_or_si256(_mm256_or_si256(r, b), _mm256_or_si256(rk, bk)),
+                                            _mm256_set1_epi64x(-1));
+        __m256i up = _mm256_or_si256(kings, _mm256_andnot_si256(t, men));
+        __m256i down = _mm256_or_si256(kings, _mm256_and_si256(t, men));
+
+        __m256i s9 = _mm256_and_si256(AVX2_SHIFT(_mm256_and_si256(up, c7), 9), empty);
+        __m256i s7 = _mm256_and_si256(AVX2_SHIFT(_mm256_and_si256(up, c0), 7), empty);
+        __m256i sm7 = _mm256_and_si256(AVX2_SHIFT(_mm256_and_si256(down, c7), -7), empty);
+        __m256i sm9 = _mm256_and_si256(AVX2_SHIFT(_mm256_and_si256(down, c0), -9), empty);
+
+        __m256i j9 = _mm256_and_si256(AVX2_SHIFT(_mm256_and_si256(AVX2_SHIFT(_mm256_and_si256(up, c67), 9), enemy), 9), empty);
+        __m256i j7 = _mm256_and_si256(AVX2_SHIFT(_mm256_and_si256(AVX2_SHIFT(_mm256_and_si256(up, c01), 7), enemy), 7), empty);
+        __m256i jm7 = _mm256_and_si256(AVX2_SHIFT(_mm256_and_si256(AVX2_SHIFT(_mm256_and_si256(down, c67), -7), enemy), -7), empty);
+        __m256i jm9 = _mm256_and_si256(AVX2_SHIFT(_mm256_and_si256(AVX2_SHIFT(_mm256_and_si256(down, c01), -9), enemy), -9), empty);
+
+        __m256i mv = _mm256_or_si256(_mm256_or_si256(AVX2_SHIFT(s9, -9), AVX2_SHIFT(s7, -7)),
+                                     _mm256_or_si256(AVX2_SHIFT(sm7, 7), AVX2_SHIFT(sm9, 9)));
+        __m256i jp = _mm256_or_si256(_mm256_or_si256(AVX2_SHIFT(j9, -18), AVX2_SHIFT(j7, -14)),
+                                     _mm256_or_si256(AVX2_SHIFT(jm7, 14), AVX2_SHIFT(jm9, 18)));
+        _mm256_storeu_si256((__m256i *)(movers + i), mv);
+        _mm256_storeu_si256((__m256i *)(jumpers + i), jp);
+
+        __m256i step_bytes = _mm256_add_epi8(_mm256_add_epi8(avx2_byte_popcount(s9), avx2_byte_popcount(s7)),
+                                             _mm256_add_epi8(avx2_byte_popcount(sm7), avx2_byte_popcount(sm9)));
+        __m256i jump_bytes = _mm256_add_epi8(_mm256_add_epi8(avx2_byte_popcount(j9), avx2_byte_popcount(j7)),
+                                             _mm256_add_epi8(avx2_byte_popcount(jm7), avx2_byte_popcount(jm9)));
+        __m256i steps = _mm256_sad_epu8(step_bytes, zero), jumps = _mm256_sad_epu8(jump_bytes, zero); // each lane's byte sum
+        uint64_t lane[4]; // jumps, or the steps in lanes without any
+        _mm256_storeu_si256((__m256i *)lane, _mm256_blendv_epi8(jumps, steps, _mm256_cmpeq_epi64(jumps, zero)));
+        for (int k = 0; k < 4; k++) counts[i + k] = (uint16_t)lane[k];
+    }
+    return i; // how many got done, the caller finishes the rest
+}
+
+/**
+ * AVX-512 - 8 positions per step, same steps as the AVX2 version
+ * Needs AVX512BW on top of AVX512F for the byte shuffle popcount
+ */
+#define AVX512_SHIFT(v, d) ((d) > 0 ? _mm512_slli_epi64(v, (d)) : _mm512_srli_epi64(v, -(d)))
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i avx512_byte_popcount(__m512i v) {
+    const __m512i table = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+    const __m512i low = _mm512_set1_epi8(0x0F);
+    __m512i lo = _mm512_shuffle_epi8(table, _mm512_and_si512(v, low));
+    __m512i hi = _mm512_shuffle_epi8(table, _mm512_and_si512(_mm512_srli_epi16(v, 4), low));
+    return _mm512_add_epi8(lo, hi);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t batch_avx512(const uint64_t *red, const uint64_t *black, const uint64_t *red_kings,
+                           const uint64_t *black_kings, const uint8_t *turn, size_t n,
+                           uint64_t *movers, uint64_t *jumpers, uint16_t *counts) {
+    const __m512i c0 = _mm512_set1_epi64((long long)NOT_COL_0), c7 = _mm512_set1_epi64((long long)NOT_COL_7);
+    const __m512i c01 = _mm512_set1_epi64((long long)NOT_COL_01), c67 = _mm512_set1_epi64((long long)NOT_COL_67);
+    const __m512i zero = _mm512_setzero_si512();
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i r = _mm512_loadu_si512(red + i);
+        __m512i b = _mm512_loadu_si512(black + i);
+        __m512i rk = _mm512_loadu_si512(red_kings + i);
+        __m512i bk = _mm512_loadu_si512(black_kings + i);
+
+        // 8 turn bytes -> 8 lanes, then every nonzero lane becomes all 1s
+        __m512i tv = _mm512_cvtepu8_epi64(_mm_loadl_epi64((const __m128i *)(turn + i)));
+        __m512i t = _mm512_maskz_mov_epi64(_mm512_test_epi64_mask(tv, tv), _mm512_set1_epi64(-1));
+
+        __m512i men = _mm512_or_si512(_mm512_andnot_si512(t, r), _mm512_and_si512(t, b));
+        __m512i kings = _mm512_or_si512(_mm512_andnot_si512(t, rk), _mm512_and_si512(t, bk));
+        __m512i enemy = _mm512_or_si512(_mm512_andnot_si512(t, _mm512_or_si512(b, bk)),
+                                        _mm512_and_si512(t, _mm512_or_si512(r, rk)));
+        __m512i empty = _mm512_andnot_si512(_mm512_or_si512(_mm512_or_si512(r, b), _mm512_or_si512(rk, bk)),
+                                            _mm512_set1_epi64(-1));
+        __m512i up = _mm512_or_si512(kings, _mm512_andnot_si512(t, men));
+        __m512i down = _mm512_or_si512(kings, _mm512_and_si512(t, men));
+
+        __m512i s9 = _mm512_and_si512(AVX512_SHIFT(_mm512_and_si512(up, c7), 9), empty);
+        __m512i s7 = _mm512_and_si512(AVX512_SHIFT(_mm512_and_si512(up, c0), 7), empty);
+        __m512i sm7 = _mm512_and_si512(AVX512_SHIFT(_mm512_and_si512(down, c7), -7), empty);
+        __m512i sm9 = _mm512_and_si512(AVX512_SHIFT(_mm512_and_si512(down, c0), -9), empty);
+
+        __m512i j9 = _mm512_and_si512(AVX512_SHIFT(_mm512_and_si512(AVX512_SHIFT(_mm512_and_si512(up, c67), 9), enemy), 9), empty);
+        __m512i j7 = _mm512_and_si512(AVX512_SHIFT(_mm512_and_si512(AVX512_SHIFT(_mm512_and_si512(up, c01), 7), enemy), 7), empty);
+        __m512i jm7 = _mm512_and_si512(AVX512_SHIFT(_mm512_and_si512(AVX512_SHIFT(_mm512_and_si512(down, c67), -7), enemy), -7), empty);
+        __m512i jm9 = _mm512_and_si512(AVX512_SHIFT(_mm512_and_si512(AVX512_SHIFT(_mm512_and_si512(down, c01), -9), enemy), -9), empty);
+
+        __m512i mv = _mm512_or_si512(_mm512_or_si512(AVX512_SHIFT(s9, -9), AVX512_SHIFT(s7, -7)),
+                                     _mm512_or_si512(AVX512_SHIFT(sm7, 7), AVX512_SHIFT(sm9, 9)));
+        __m512i jp = _mm512_or_si512(_mm512_or_si512(AVX512_SHIFT(j9, -18), AVX512_SHIFT(j7, -14)),
+                                     _mm512_or_si512(AVX512_SHIFT(jm7, 14), AVX512_SHIFT(jm9, 18)));
+        _mm512_storeu_si512(movers + i, mv);
+        _mm512_storeu_si512(jumpers + i, jp);
+
+        __m512i step_bytes = _mm512_add_epi8(_mm512_add_epi8(avx512_byte_popcount(s9), avx512_byte_popcount(s7)),
+                                             _mm512_add_epi8(avx512_byte_popcount(sm7), avx512_byte_popcount(sm9)));
+        __m512i jump_bytes = _mm512_add_epi8(_mm512_add_epi8(avx512_byte_popcount(j9), avx512_byte_popcount(j7)),
+                                             _mm512_add_epi8(avx512_byte_popcount(jm7), avx512_byte_popcount(jm9)));
+        __m512i steps = _mm512_sad_epu8(step_bytes, zero), jumps = _mm512_sad_epu8(jump_bytes, zero);
+        __m512i count = _mm512_mask_blend_epi64(_mm512_test_epi64_mask(jumps, jumps), steps, jumps); // jumps win where there are any
+        // the 8 lane sums are at most 4 * 8 = 32 each, so they fit in 16 bits
+        _mm_storeu_si128((__m128i *)(counts + i), _mm512_cvtepi64_epi16(count));
+    }
+    return i;
+}
+
+#endif // BATCH_X86
+
+enum { BATCH_SCALAR = 0, BATCH_AVX2 = 1, BATCH_AVX512 = 2 };
+const char *const batch_backend_names[3] = {"scalar", "avx2", "avx512"};
+static int batch_backend = -1; // -1 = not picked yet
+
+/**
+ * Pick which version batch_movegen() uses, falling back to the best one the CPU has if it
+ * doesn't support the one asked for. Returns the one actually in use
+ */
+int set_batch_backend(int which) {
+    int best = BATCH_SCALAR;
+#if BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) best = BATCH_AVX2;
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) best = BATCH_AVX512;
+#endif
+    batch_backend = which < best ? which : best;
+    return batch_backend;
+}
+
+/**
+ * Movers, jumpers and move counts for positions 0..n-1 (see the top of the file)
+ * The input arrays don't need any special alignment
+ */
+void batch_movegen(const uint64_t *red, const uint64_t *black, const uint64_t *red_kings,
+                   const uint64_t *black_kings, const uint8_t *turn, size_t n,
+                   uint64_t *movers, uint64_t *jumpers, uint16_t *counts) {
+    if (batch_backend < 0) set_batch_backend(BATCH_AVX512);
+
+    size_t done = 0;
+#if BATCH_X86
+    if (batch_backend == BATCH_AVX512)
+        done = batch_avx512(red, black, red_kings, black_kings, turn, n, movers, jumpers, counts);
+    else if (batch_backend == BATCH_AVX2)
+        done = batch_avx2(red, black, red_kings, black_kings, turn, n, movers, jumpers, counts);
+#endif
+    batch_scalar(red + done, black + done, red_kings + done, black_kings + done, turn + done, n - done,
+                 movers + done, jumpers + done, counts + done);
+}
@@ -89,14 +89,144 @@ int get_bit(uint64_t board, int pos) {
     return (board >> pos) & 1ULL;
 }
 
+// ---------- FAST BIT PRIMITIVES ----------
+
+/**
+ * popcount / lsb_index / pop_lsb / pext / pdep come in two flavours:
+ *   - portable: plain C that works on any CPU
+ *   - hardware: the POPCNT, TZCNT (BMI1) and PEXT/PDEP (BMI2) instructions
+ * The CPU gets checked once at startup (init_bitops runs before main) and the best one that
+ * the CPU actually has gets picked, so one binary runs everywhere and is still fast on new chips
+ */
+
+// Portable popcount - add neighbouring bits in pairs, then nibbles, then bytes (no loop at all)
+static int popcount_portable(uint64_t b) {
+    b = b - ((b >> 1) & 0x5555555555555555ULL);
+    b = (b & 0x3333333333333333ULL) + ((b >> 2) & 0x3333333333333333ULL);
+    b = (b + (b >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((b * 0x0101010101010101ULL) >> 56); // sum of all 8 byte counts ends up in the top byte
+}
+
+/**
+ * Portable lowest set bit - isolate it with b & -b, then a de Bruijn multiply puts a unique
+ * 6 bit pattern in the top bits for each of the 64 positions, which indexes the table
+ * b must not be 0
+ */
+static const int debruijn_index[64] = {
+     0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+    62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+    63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+    46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6
+};
+static int lsb_index_portable(uint64_t b) {
+    return debruijn_index[((b & -b) * 0x03F79D71B4CB0A89ULL) >> 58];
+}
+
+// Portable PEXT - pull the bits of 'src' sitting under 'mask' down into the low bits, in order
+static uint64_t pext_portable(uint64_t src, uint64_t mask) {
+    uint64_t out = 0;
+    for (uint64_t bit = 1; mask; bit <<= 1) {
+        if (src & mask & -mask) out |= bit;
+        mask &= mask - 1; // next mask bit
+    }
+    return out;
+}
+
+// Portable PDEP - the opposite, spread the low bits of 'src' out onto the bits of 'mask'
+static uint64_t pdep_portable(uint64_t src, uint64_t mask) {
+    uint64_t out = 0;
+    for (uint64_t bit = 1; mask; bit <<= 1) {
+        if (src & bit) out |= mask & -mask;
+        mask &= mask - 1;
+    }
+    return out;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITOPS_X86 1
+
+// Each of these is compiled for just that one instruction set extension, so they're only safe
+// to call once init_bitops() checked the CPU has it
+__attribute__((target("popcnt"))) static int popcount_hw(uint64_t b) { return __builtin_popcountll(b); }
+__attribute__((target("bmi"))) static int lsb_index_hw(uint64_t b) { return (int)_tzcnt_u64(b); }
+__attribute__((target("bmi2"))) static uint64_t pext_hw(uint64_t src, uint64_t mask) { return _pext_u64(src, mask); }
+__attribute__((target("bmi2"))) static uint64_t pdep_hw(uint64_t src, uint64_t mask) { return _pdep_u64(src, mask); }
+#else
+#define BITOPS_X86 0
+#endif
+
+// The functions everything calls through, they start out portable and init_bitops() upgrades them
+typedef struct {
+    int (*popcount)(uint64_t);
+    int (*lsb_index)(uint64_t);
+    uint64_t (*pext)(uint64_t, uint64_t);
+    uint64_t (*pdep)(uint64_t, uint64_t);
+    const char *name;   // which instructions are in use, for printing
+} BitopsBackend;
+
+static BitopsBackend bitops = {popcount_portable, lsb_index_portable, pext_portable, pdep_portable, "portable"};
+
+enum { BITOPS_PORTABLE = 0, BITOPS_HARDWARE = 1 };
+
+/**
+ * Switch between the portable code and the hardware instructions (what the CPU supports of them)
+ * Returns 0 if hardware was asked for but the CPU has none of it
+ */
+int set_bitops_backend(int which) {
+    bitops = (BitopsBackend){popcount_portable, lsb_index_portable, pext_portable, pdep_portable, "portable"};
+    if (which != BITOPS_HARDWARE) return 1;
+#if BITOPS_X86
+    __builtin_cpu_init();
+    int any = 0;
+    if (__builtin_cpu_supports("popcnt")) { bitops.popcount = popcount_hw; any = 1; }
+    if (__builtin_cpu_supports("bmi")) { bitops.lsb_index = lsb_index_hw; any = 1; }
+    if (__builtin_cpu_supports("bmi2")) { bitops.pext = pext_hw; bitops.pdep = pdep_hw; any = 1; }
+    if (any) bitops.name = __builtin_cpu_supports("bmi2") ? "popcnt+bmi2" : "popcnt";
+    return any;
+#else
+    return 0;
+#endif
+}
+
+// Runs before main() - pick the hardware versions if the CPU has them
+__attribute__((constructor)) static void init_bitops(void) {
+    set_bitops_backend(BITOPS_HARDWARE);
+}
+
+// Number of 1 bits
+static inline int popcount(uint64_t board) { return bitops.popcount(board); }
+
+/**
+ * Index (0-63) of the lowest 1 bit, board must not be 0
+ * This one is in every piece walk, so with GCC/clang it skips the function pointer: the builtin
+ * compiles to "rep bsf", which the CPU itself runs as TZCNT when it has BMI and as BSF when it doesn't
+ */
+static inline int lsb_index(uint64_t board) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(board);
+#else
+    return bitops.lsb_index(board);
+#endif
+}
+
+/**
+ * Index of the lowest 1 bit AND clear it from the board - the way to walk every piece on a board
+ * without checking all 64 squares:  while (b) { int pos = pop_lsb(&b); ... }
+ */
+static inline int pop_lsb(uint64_t *board) {
+    int pos = lsb_index(*board);
+    *board &= *board - 1; // b & (b - 1) drops the lowest 1 bit
+    return pos;
+}
+
+// Gather the bits of 'board' under 'mask' into the low bits / scatter low bits back out onto 'mask'
+static inline uint64_t pext(uint64_t board, uint64_t mask) { return bitops.pext(board, mask); }
+static inline uint64_t pdep(uint64_t board, uint64_t mask) { return bitops.pdep(board, mask); }
+
 // Count how many bits are set to 1 
 int count_bits(uint64_t board) {
-    int count = 0;
-    while (board) {
-        count += board & 1ULL;  // If it is a 1, then we can increase count
-        board >>= 1;            // Move everything by 1 (This is okay because its a local reference)
-    }
-    return count;
+    return popcount(board); // POPCNT when the CPU has it, otherwise the no-loop portable version
 }
 
 // Print the board as an 8x8 grid
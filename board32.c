@@ -0,0 +1,51 @@
+/**
+ * 32 square board - pieces only ever stand on the 32 dark squares, so a side fits in 32 bits
+ *
+ * Included from checkers.c right after zobrist.c, before any of the rules helpers
+ *
+ * The game itself keeps working on 64 bit boards (the shifts in movegen.c need the row * 8 + col
+ * layout), this is the form for everything that gets stored: half the bytes per board in tables,
+ * files and hash entries. Going between the two is one pext/pdep against DARK_SQUARES, or the
+ * square_to_dark[] / dark_to_square[] tables for single squares
+ *
+ * The tables (and the dark_step/dark_jump neighbor tables) come from gen_tables.c at build time,
+ * board32_tables.h is its output
+ */
+#include "board32_tables.h"
+
+#define DARK_SQUARES 0x55AA55AA55AA55AAULL // every square with row + col odd
+
+// GameState's four boards squeezed to the dark squares, 16 bytes instead of 32
+typedef struct {
+    uint32_t red;
+    uint32_t black;
+    uint32_t red_kings;
+    uint32_t black_kings;
+} Board32;
+
+// 64 square board -> 32 bit dark square set (bit i = dark square i)
+static inline uint32_t to_dark32(uint64_t board) {
+    return (uint32_t)pext(board, DARK_SQUARES);
+}
+
+// 32 bit dark square set -> 64 square board
+static inline uint64_t from_dark32(uint32_t board) {
+    return pdep(board, DARK_SQUARES);
+}
+
+Board32 board32_pack(const GameState *g) {
+    Board32 b = {to_dark32(g->red), to_dark32(g->black), to_dark32(g->red_kings), to_dark32(g->black_kings)};
+    return b;
+}
+
+// Back to a GameState, 'turn' isn't part of the board so it gets passed in. The hash and eval get recomputed
+void board32_unpack(const Board32 *b, int turn, GameState *g) {
+    g->red = from_dark32(b->red);
+    g->black = from_dark32(b->black);
+    g->red_kings = from_dark32(b->red_kings);
+    g->black_kings = from_dark32(b->black_kings);
+    g->turn = turn;
+    g->hash = compute_hash(g);
+    g->eval = compute_eval(g);
+    NN_REFRESH(g);
+}
@@ -0,0 +1,97 @@
+// Generated by gen_tables.c - don't edit, rerun: ./gen_tables > board32_tables.h
+
+// row * 8 + col -> dark square 0-31, -1 for light squares
+static const int8_t square_to_dark[64] = {
+     -1,  0, -1,  1, -1,  2, -1,  3,
+      4, -1,  5, -1,  6, -1,  7, -1,
+     -1,  8, -1,  9, -1, 10, -1, 11,
+     12, -1, 13, -1, 14, -1, 15, -1,
+     -1, 16, -1, 17, -1, 18, -1, 19,
+     20, -1, 21, -1, 22, -1, 23, -1,
+     -1, 24, -1, 25, -1, 26, -1, 27,
+     28, -1, 29, -1, 30, -1, 31, -1
+};
+
+// dark square 0-31 -> row * 8 + col
+static const uint8_t dark_to_square[32] = {
+     1,  3,  5,  7,
+     8, 10, 12, 14,
+    17, 19, 21, 23,
+    24, 26, 28, 30,
+    33, 35, 37, 39,
+    40, 42, 44, 46,
+    49, 51, 53, 55,
+    56, 58, 60, 62
+};
+
+// Dark square one step away in each direction (up right, up left, down right, down left), -1 = off the board
+static const int8_t dark_step[32][4] = {
+    {  5,  4, -1, -1}, // 0
+    {  6,  5, -1, -1}, // 1
+    {  7,  6, -1, -1}, // 2
+    { -1,  7, -1, -1}, // 3
+    {  8, -1,  0, -1}, // 4
+    {  9,  8,  1,  0}, // 5
+    { 10,  9,  2,  1}, // 6
+    { 11, 10,  3,  2}, // 7
+    { 13, 12,  5,  4}, // 8
+    { 14, 13,  6,  5}, // 9
+    { 15, 14,  7,  6}, // 10
+    { -1, 15, -1,  7}, // 11
+    { 16, -1,  8, -1}, // 12
+    { 17, 16,  9,  8}, // 13
+    { 18, 17, 10,  9}, // 14
+    { 19, 18, 11, 10}, // 15
+    { 21, 20, 13, 12}, // 16
+    { 22, 21, 14, 13}, // 17
+    { 23, 22, 15, 14}, // 18
+    { -1, 23, -1, 15}, // 19
+    { 24, -1, 16, -1}, // 20
+    { 25, 24, 17, 16}, // 21
+    { 26, 25, 18, 17}, // 22
+    { 27, 26, 19, 18}, // 23
+    { 29, 28, 21, 20}, // 24
+    { 30, 29, 22, 21}, // 25
+    { 31, 30, 23, 22}, // 26
+    { -1, 31, -1, 23}, // 27
+    { -1, -1, 24, -1}, // 28
+    { -1, -1, 25, 24}, // 29
+    { -1, -1, 26, 25}, // 30
+    { -1, -1, 27, 26}  // 31
+};
+
+// Landing square of a jump in each direction (the piece jumped is dark_step[][] the same way), -1 = off the board
+static const int8_t dark_jump[32][4] = {
+    {  9, -1, -1, -1}, // 0
+    { 10,  8, -1, -1}, // 1
+    { 11,  9, -1, -1}, // 2
+    { -1, 10, -1, -1}, // 3
+    { 13, -1, -1, -1}, // 4
+    { 14, 12, -1, -1}, // 5
+    { 15, 13, -1, -1}, // 6
+    { -1, 14, -1, -1}, // 7
+    { 17, -1,  1, -1}, // 8
+    { 18, 16,  2,  0}, // 9
+    { 19, 17,  3,  1}, // 10
+    { -1, 18, -1,  2}, // 11
+    { 21, -1,  5, -1}, // 12
+    { 22, 20,  6,  4}, // 13
+    { 23, 21,  7,  5}, // 14
+    { -1, 22, -1,  6}, // 15
+    { 25, -1,  9, -1}, // 16
+    { 26, 24, 10,  8}, // 17
+    { 27, 25, 11,  9}, // 18
+    { -1, 26, -1, 10}, // 19
+    { 29, -1, 13, -1}, // 20
+    { 30, 28, 14, 12}, // 21
+    { 31, 29, 15, 13}, // 22
+    { -1, 30, -1, 14}, // 23
+    { -1, -1, 17, -1}, // 24
+    { -1, -1, 18, 16}, // 25
+    { -1, -1, 19, 17}, // 26
+    { -1, -1, -1, 18}, // 27
+    { -1, -1, 21, -1}, // 28
+    { -1, -1, 22, 20}, // 29
+    { -1, -1, 23, 21}, // 30
+    { -1, -1, -1, 22}  // 31
+};
@@ -0,0 +1,131 @@
+/**
+ * Opening book - moves for positions we've seen in real games, so the engine doesn't search them
+ *
+ * Included from checkers.c after records.c (same mmap headers). bookgen.c builds the file
+ *
+ * The file is a header and then one BookEntry per (position, move), sorted by the position's
+ * Zobrist hash. Every move for a position sits next to the others. Finding a position is an
+ * interpolation search: hashes are spread evenly over all 64 bit numbers, so a key's value says
+ * about where in the file it is. That takes a couple of probes instead of the ~20 a binary search
+ * needs for a million entries (it switches to binary search if it's taking too long)
+ *
+ * Opening the book is only the mmap, nothing gets read until a probe touches it
+ */
+
+#define BOOK_VERSION 1
+#define BOOK_DEFAULT_FILE "checkers.book"
+
+typedef struct {
+    uint64_t key;       // GameState.hash of the position before the move
+    uint32_t captures;  // the move's captured squares as a 32 square set (to_dark32()), picks between jumps
+    uint8_t from, to;
+    uint16_t weight;    // how good / how often played, more = picked first
+} BookEntry;
+
+_Static_assert(sizeof(BookEntry) == 16, "entries are read straight out of the file");
+
+typedef struct {
+    char magic[8];          // "BBCHKBK"
+    uint32_t version;       // BOOK_VERSION
+    uint32_t entry_size;    // sizeof(BookEntry)
+    uint64_t count;         // entries after the header
+} BookHeader;
+
+typedef struct {
+    const BookEntry *entries;   // NULL = no book
+    uint64_t count;
+    void *map;
+    size_t map_size;
+} Book;
+
+static Book book; // the one the game uses
+
+/**
+ * mmap a book file
+ * Returns the number of entries, 0 if there's no file or it isn't a book
+ */
+uint64_t book_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BookHeader)) { close(fd); return 0; }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    const BookHeader *h = map;
+    if (memcmp(h->magic, "BBCHKBK", 8) != 0 || h->version != BOOK_VERSION || h->entry_size != sizeof(BookEntry) ||
+        h->count > ((size_t)st.st_size - sizeof(BookHeader)) / sizeof(BookEntry)) {
+        munmap(map, (size_t)st.st_size); // Error catch - not a book, or cut off
+        return 0;
+    }
+    madvise(map, (size_t)st.st_size, MADV_RANDOM);
+
+    if (book.map) munmap(book.map, book.map_size);
+    book.entries = (const BookEntry *)(h + 1);
+    book.count = h->count;
+    book.map = map;
+    book.map_size = (size_t)st.st_size;
+    return book.count;
+}
+
+/**
+ * Index of the first entry with this key, or -1 if there isn't one
+ * Interpolation search, falling back to halving the range once it's been going a while
+ * (only happens if the keys are bunched up, which real hashes aren't)
+ */
+static int64_t book_find(const Book *b, uint64_t key) {
+    if (b->count == 0) return -1;
+    uint64_t lo = 0, hi = b->count - 1; // the key can only be in entries[lo..hi]
+    for (int probes = 0; lo <= hi; probes++) {
+        uint64_t lo_key = b->entries[lo].key, hi_key = b->entries[hi].key;
+        if (key < lo_key || key > hi_key) return -1;
+
+        uint64_t mid;
+        if (probes < 8 && hi_key > lo_key) // guess the spot from where the key falls between the ends
+            mid = lo + (uint64_t)((double)(key - lo_key) / (double)(hi_key - lo_key) * (double)(hi - lo));
+        else
+            mid = lo + (hi - lo) / 2;
+        if (mid > hi) mid = hi;
+
+        uint64_t k = b->entries[mid].key;
+        if (k == key) {
+            while (mid > 0 && b->entries[mid - 1].key == key) mid--; // back up to this position's first move
+            return (int64_t)mid;
+        }
+        if (k < key) lo = mid + 1;
+        else { if (mid == 0) return -1; hi = mid - 1; }
+    }
+    return -1;
+}
+
+/**
+ * Book move for 'g': the highest weight move stored for this position (the first one on a tie),
+ * so the same position always gets the same move
+ * Every move gets matched against generate_moves() first, so a hash collision can't play
+ * something illegal. Returns 1 and fills 'out', 0 if the book has nothing here
+ */
+int book_probe(GameState *g, Move *out) {
+    if (!book.entries) return 0;
+    int64_t i = book_find(&book, g->hash);
+    if (i < 0) return 0;
+
+    MoveList list;
+    generate_moves(g, &list);
+    int found = 0, best_weight = -1;
+    for (uint64_t e = (uint64_t)i; e < book.count && book.entries[e].key == g->hash; e++) {
+        const BookEntry *be = &book.entries[e];
+        if (be->weight <= best_weight) continue;
+        for (int m = 0; m < list.count; m++) {
+            Move *mv = &list.moves[m];
+            if (mv->from == be->from && mv->to == be->to && to_dark32(mv->captures) == be->captures) {
+                *out = *mv;
+                best_weight = be->weight;
+                found = 1;
+                break;
+            }
+        }
+    }
+    return found;
+}
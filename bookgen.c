@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#define CHECKERS_NO_MAIN // rules + book format out of checkers.c, our own main()
+#include "checkers.c"
+
+/**
+ * Opening book builder - reads games and writes the sorted file book.c mmaps
+ *
+ * Usage: ./bookgen [-o file] [-p plies] [-m min_games] games.txt...
+ *   -o file (default checkers.book), -p only the first 'plies' moves of each game (default 20),
+ *   -m a move has to show up in at least this many games to make it in (default 2)
+ *
+ * Game files: one game per line in standard notation (see parse_move()), e.g.
+ *   1. 11-15 23-19 2. 8-11 22-17 ... 1-0
+ * Move numbers get skipped, a result at the end counts for the weights:
+ *   1-0 = red (the side that moves first) won, 0-1 = black won, 1/2-1/2 = draw, * or nothing = unknown
+ * Lines starting with # are comments. A move that isn't legal ends that game where it is
+ *
+ * Weight of a move = 2 per game the side playing it won, 1 per draw/unknown, 0 per loss, so the
+ * book prefers moves that did well over ones that just got played a lot
+ */
+
+typedef struct {
+    uint64_t key;
+    uint32_t captures;
+    uint8_t from, to;
+    uint32_t weight;
+    uint32_t games;
+} BookMove;
+
+static BookMove *moves = NULL;
+static size_t move_count = 0, move_cap = 0;
+
+static int add_book_move(uint64_t key, const Move *m, int weight) {
+    if (move_count == move_cap) {
+        size_t cap = move_cap ? move_cap * 2 : 1 << 16;
+        BookMove *grown = realloc(moves, cap * sizeof(BookMove));
+        if (!grown) return 0;
+        moves = grown;
+        move_cap = cap;
+    }
+    moves[move_count++] = (BookMove){key, to_dark32(m->captures), m->from, m->to, (uint32_t)weight, 1};
+    return 1;
+}
+
+static int compare_moves(const void *a, const void *b) {
+    const BookMove *x = a, *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    if (x->from != y->from) return x->from - y->from;
+    if (x->to != y->to) return x->to - y->to;
+    return x->captures < y->captures ? -1 : x->captures > y->captures;
+}
+
+/**
+ * One game line -> book moves. The whole line gets split up first since the result at the end
+ * decides the weights of every move before it
+ * Returns 0 if a move wasn't legal (everything before it still counts)
+ */
+static int read_game(char *line, int max_plies, int line_no) {
+    int winner = -1; // 0 red, 1 black, 2 draw, -1 unknown
+    char *tokens[1024];
+    int n = 0;
+    for (char *t = strtok(line, " \t\r\n"); t && n < 1024; t = strtok(NULL, " \t\r\n")) {
+        if (strcmp(t, "1-0") == 0) winner = 0;
+        else if (strcmp(t, "0-1") == 0) winner = 1;
+        else if (strcmp(t, "1/2-1/2") == 0) winner = 2;
+        else if (strcmp(t, "*") == 0) continue;
+        else if (t[strlen(t) - 1] == '.') continue; // move number
+        else tokens[n++] = t;
+    }
+
+    GameState g;
+    init_board(&g);
+    for (int ply = 0; ply < n && ply < max_plies; ply++) {
+        Move m;
+        if (!parse_move(&g, tokens[ply], &m)) {
+            fprintf(stderr, "line %d: move %d \"%s\" isn't legal, rest of the game skipped\n", line_no, ply + 1, tokens[ply]);
+            return 0;
+        }
+        int weight = winner < 0 || winner == 2 ? 1 : winner == g.turn ? 2 : 0;
+        if (!add_book_move(g.hash, &m, weight)) { fprintf(stderr, "Out of memory.\n"); exit(1); }
+        apply_move(&g, &m);
+        switch_turn(&g);
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    const char *out = BOOK_DEFAULT_FILE;
+    int max_plies = 20, min_games = 2;
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (strcmp(argv[arg], "-o") == 0) out = argv[arg + 1];
+        else if (strcmp(argv[arg], "-p") == 0) max_plies = atoi(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-m") == 0) min_games = atoi(argv[arg + 1]);
+    }
+    if (arg >= argc) { printf("Usage: %s [-o file] [-p plies] [-m min_games] games.txt...\n", argv[0]); return 1; }
+
+    int games = 0, bad = 0;
+    for (; arg < argc; arg++) {
+        FILE *f = fopen(argv[arg], "r");
+        if (!f) { printf("Can't read %s\n", argv[arg]); return 1; }
+        char *line = NULL;
+        size_t cap = 0;
+        int line_no = 0;
+        while (getline(&line, &cap, f) > 0) {
+            line_no++;
+            if (line[0] == '#' || strspn(line, " \t\r\n") == strlen(line)) continue; // comment / blank
+            games++;
+            if (!read_game(line, max_plies, line_no)) bad++;
+        }
+        free(line);
+        fclose(f);
+    }
+
+    // same (position, move) from different games -> one entry
+    qsort(moves, move_count, sizeof(BookMove), compare_moves);
+    size_t kept = 0;
+    for (size_t i = 0; i < move_count; ) {
+        BookMove merged = moves[i];
+        size_t j = i + 1;
+        for (; j < move_count && compare_moves(&moves[j], &merged) == 0; j++) {
+            merged.weight += moves[j].weight;
+            merged.games++;
+        }
+        if ((int)merged.games >= min_games && merged.weight > 0) moves[kept++] = merged;
+        i = j;
+    }
+
+    FILE *f = fopen(out, "wb");
+    if (!f) { printf("Can't write %s\n", out); return 1; }
+    BookHeader h = {"BBCHKBK", BOOK_VERSION, sizeof(BookEntry), kept};
+    fwrite(&h, sizeof(h), 1, f);
+    for (size_t i = 0; i < kept; i++) {
+        BookEntry e = {moves[i].key, moves[i].captures, moves[i].from, moves[i].to,
+                       (uint16_t)(moves[i].weight > 65535 ? 65535 : moves[i].weight)};
+        fwrite(&e, sizeof(e), 1, f);
+    }
+    if (fclose(f) != 0) { printf("Error writing %s\n", out); return 1; }
+
+    printf("%d games (%d cut short by an illegal move), %zu moves read, %zu book entries written to %s\n",
+           games, bad, move_count, kept, out);
+    free(moves);
+    return 0;
+}
@@ -2,6 +2,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "bitops.c" // for bit functions
+#include "stats.c" // STAT_INC() and friends - hot path counters/timers, compiled out unless -DCHECKERS_STATS
+#include "nn.c" // nn_forward() - quantized net evaluation, its accumulator lives in GameState with -DCHECKERS_NN
 
 // use "-> for the game to point to red and black"
 
@@ -12,8 +14,17 @@ typedef struct {
     uint64_t red_kings;
     uint64_t black_kings;
     int turn;  // 0 = red, 1 = black
+    int eval;  // static score from red's point of view, kept up to date by every move (see eval.c)
+    uint64_t hash;  // Zobrist hash of the boards + turn, kept up to date by every move (see zobrist.c)
+#ifdef CHECKERS_NN
+    int16_t nn_acc[NN_HIDDEN];  // first layer of the net for these boards, kept up to date by every move (see nn.c)
+#endif
 } GameState;
 
+#include "zobrist.c" // the random keys behind GameState.hash
+#include "eval.c" // the per-square values behind GameState.eval
+#include "board32.c" // Board32 + the 32 dark square lookup tables (generated by gen_tables.c)
+
 // ---------- HELPER FUNCTIONS ----------
 
 /**
@@ -71,6 +82,10 @@ void init_board(GameState *g) {
                 g->black = set_bit(g->black, r * 8 + c);
         }
     }
+
+    g->hash = compute_hash(g); // only full hash we ever need, moves update it from here on
+    g->eval = compute_eval(g); // same for the score
+    NN_REFRESH(g);
 }
 
 /**
@@ -80,12 +95,9 @@ int on_board(int pos) { return pos >= 0 && pos < 64; }
 
 /**
  * Check if a position is a dark square (playable in checkers)
- * Dark squares have odd sum of row + col
+ * Dark squares have odd sum of row + col - the generated table already knows which ones those are
  */
-int dark_square(int pos) { 
-    int r = pos / 8, c = pos % 8; 
-    return ((r + c) % 2) == 1; 
-}
+int dark_square(int pos) { return square_to_dark[pos] >= 0; }
 
 /**
  * Check if any piece (red, black, or kings) occupies this position
@@ -101,18 +113,26 @@ int occupied(GameState *g, int pos) {
  * Player loses when they have no pieces left
  */
 int check_winner(GameState *g) {
-    int red_total = total_pieces(g->red, g->red_kings);
-    int black_total = total_pieces(g->black, g->black_kings);
-    if (red_total == 0) return 1;
-    if (black_total == 0) return 2;
+    if (!(g->red | g->red_kings)) return 1; // no need to count them, just whether there's any
+    if (!(g->black | g->black_kings)) return 2;
     return 0;
 }
 
+/**
+ * Switch to the other player's turn (0 <-> 1) and flip the turn part of the hash with it
+ */
+void switch_turn(GameState *g) {
+    g->turn = 1 - g->turn;
+    g->hash ^= zobrist_turn;
+    CHECK_HASH(g);
+}
+
 /**
  * Promote pieces to kings when they reach the opposite end
  * Red pieces on top row (row 7) become red kings
  * Black pieces on bottom row (row 0) become black kings
  * Moves promoted pieces from regular bitboard to king bitboard
+ * Each crowned piece leaves the men hash and joins the kings hash (and swaps a man's score for a king's)
  */
 void promote(GameState *g) {
     uint64_t top_row = 0xFF00000000000000ULL; // Hexa for 56 - 63: THE TOP ROW
@@ -122,18 +142,129 @@ void promote(GameState *g) {
     g->red_kings |= new_red_kings; g->red &= ~new_red_kings; // mash together
     uint64_t new_black_kings = g->black & bottom_row;
     g->black_kings |= new_black_kings; g->black &= ~new_black_kings; // mash together
+
+    while (new_red_kings) { // almost always zero or one piece
+        int pos = pop_lsb(&new_red_kings);
+        g->hash ^= zobrist_keys[Z_RED][pos] ^ zobrist_keys[Z_RED_KINGS][pos];
+        g->eval += eval_square[Z_RED_KINGS][pos] - eval_square[Z_RED][pos];
+        NN_SUB(g, Z_RED, pos); NN_ADD(g, Z_RED_KINGS, pos);
+    }
+    while (new_black_kings) {
+        int pos = pop_lsb(&new_black_kings);
+        g->hash ^= zobrist_keys[Z_BLACK][pos] ^ zobrist_keys[Z_BLACK_KINGS][pos];
+        g->eval += eval_square[Z_BLACK_KINGS][pos] - eval_square[Z_BLACK][pos];
+        NN_SUB(g, Z_BLACK, pos); NN_ADD(g, Z_BLACK_KINGS, pos);
+    }
 }
 
+// ---------- SIDE SPECIALIZED RULES ----------
+
+#define TOP_ROW    0xFF00000000000000ULL // where red men get crowned
+#define BOTTOM_ROW 0x00000000000000FFULL // where black men get crowned
+
+/**
+ * The rules helpers below all used to look at g->turn first and then pick red's or black's boards,
+ * the forward direction and the crowning row - on every call, so on every hop of every jump
+ * RULES_FOR_SIDE() stamps out a _red and a _black copy of each one with all of that baked in as
+ * constants. The plain versions (valid_move() etc) just pick a copy once from the turn, and code
+ * that already knows whose turn it is (movegen.c) calls the copies directly
+ *
+ *   MEN, KINGS / EMEN, EKINGS   the mover's boards / the other side's boards
+ *   ZM, ZK / ZEM, ZEK           their zobrist key sets (and eval_square[] rows, same order)
+ *   FWD                         +1 = forward is up the board (red), -1 = down (black)
+ *   CROWN_ROW                   where the mover's men become kings
+ *
+ * (only block comments inside the macro, a // would eat the rest of it)
+ */
+#define RULES_FOR_SIDE(side, MEN, KINGS, EMEN, EKINGS, ZM, ZK, ZEM, ZEK, FWD, CROWN_ROW) \
+\
+static inline int opposite_piece_##side(GameState *g, int pos) { \
+    return on_board(pos) && (get_bit(g->EMEN, pos) || get_bit(g->EKINGS, pos)); \
+} \
+\
+static inline void move_piece_##side(GameState *g, int from, int to) { \
+    int diff = to - from; \
+    STAT_INC(MOVE_PIECE); \
+    if (get_bit(g->MEN, from)) { \
+        g->MEN = set_bit(clear_bit(g->MEN, from), to); \
+        g->hash ^= zobrist_keys[ZM][from] ^ zobrist_keys[ZM][to]; \
+        g->eval += eval_square[ZM][to] - eval_square[ZM][from]; \
+        NN_SUB(g, ZM, from); NN_ADD(g, ZM, to); \
+    } else if (get_bit(g->KINGS, from)) { \
+        g->KINGS = set_bit(clear_bit(g->KINGS, from), to); \
+        g->hash ^= zobrist_keys[ZK][from] ^ zobrist_keys[ZK][to]; \
+        g->eval += eval_square[ZK][to] - eval_square[ZK][from]; \
+        NN_SUB(g, ZK, from); NN_ADD(g, ZK, to); \
+    } \
+    if (diff == 14 || diff == 18 || diff == -14 || diff == -18) { \
+        int jumped = (from + to) / 2; \
+        if (get_bit(g->EMEN, jumped)) { \
+            g->EMEN = clear_bit(g->EMEN, jumped); \
+            g->hash ^= zobrist_keys[ZEM][jumped]; \
+            g->eval -= eval_square[ZEM][jumped]; \
+            NN_SUB(g, ZEM, jumped); \
+            STAT_INC(CAPTURES); \
+        } else if (get_bit(g->EKINGS, jumped)) { \
+            g->EKINGS = clear_bit(g->EKINGS, jumped); \
+            g->hash ^= zobrist_keys[ZEK][jumped]; \
+            g->eval -= eval_square[ZEK][jumped]; \
+            NN_SUB(g, ZEK, jumped); \
+            STAT_INC(CAPTURES); \
+        } \
+    } \
+    uint64_t crowned = g->MEN & (CROWN_ROW); /* only the side moving can have just reached its row */ \
+    g->MEN &= ~crowned; g->KINGS |= crowned; \
+    while (crowned) { \
+        int pos = pop_lsb(&crowned); \
+        g->hash ^= zobrist_keys[ZM][pos] ^ zobrist_keys[ZK][pos]; \
+        g->eval += eval_square[ZK][pos] - eval_square[ZM][pos]; \
+        NN_SUB(g, ZM, pos); NN_ADD(g, ZK, pos); \
+        STAT_INC(PROMOTIONS); \
+    } \
+    CHECK_HASH(g); \
+} \
+\
+static inline int can_capture_again_##side(GameState *g, int pos) { \
+    int king = get_bit(g->red_kings, pos) || get_bit(g->black_kings, pos); \
+    int d = square_to_dark[pos]; \
+    for (int i = 0; i < 4; i++) { \
+        if (dark_jump[d][i] < 0) continue; \
+        if (!king && (i < 2) != ((FWD) > 0)) continue; /* men only jump forward */ \
+        if (occupied(g, dark_to_square[dark_jump[d][i]])) continue; \
+        if (opposite_piece_##side(g, dark_to_square[dark_step[d][i]])) return 1; \
+    } \
+    return 0; \
+} \
+\
+static inline int is_capture_move_valid_##side(GameState *g, int from, int to) { \
+    if (!on_board(from) || !on_board(to)) return 0; \
+    if (!dark_square(to) || occupied(g, to)) return 0; \
+    int fwd = (FWD) * (to - from); \
+    if (fwd == 14 || fwd == 18) return opposite_piece_##side(g, (from + to) / 2); \
+    if (fwd == -14 || fwd == -18) \
+        return (get_bit(g->red_kings, from) || get_bit(g->black_kings, from)) && opposite_piece_##side(g, (from + to) / 2); \
+    return 0; \
+} \
+\
+static inline int valid_move_##side(GameState *g, int from, int to) { \
+    if (!on_board(from) || !on_board(to)) return 0; \
+    if (!dark_square(to) || occupied(g, to)) return 0; \
+    int fwd = (FWD) * (to - from); \
+    if (fwd == 7 || fwd == 9 || fwd == 14 || fwd == 18) return 1; \
+    if (fwd == -7 || fwd == -9 || fwd == -14 || fwd == -18) \
+        return get_bit(g->red_kings, from) || get_bit(g->black_kings, from); \
+    return 0; \
+}
+
+RULES_FOR_SIDE(red, red, red_kings, black, black_kings, Z_RED, Z_RED_KINGS, Z_BLACK, Z_BLACK_KINGS, 1, TOP_ROW)
+RULES_FOR_SIDE(black, black, black_kings, red, red_kings, Z_BLACK, Z_BLACK_KINGS, Z_RED, Z_RED_KINGS, -1, BOTTOM_ROW)
+
 /**
  * Check if there's an opponent piece at the given position
  * red_turn = 1: look for black pieces, red_turn = 0: look for red pieces
  */
 int opposite_piece(GameState *g, int pos, int red_turn) {
-    if (!on_board(pos)) return 0;
-    if (red_turn)
-        return get_bit(g->black, pos) || get_bit(g->black_kings, pos);
-    else
-        return get_bit(g->red, pos) || get_bit(g->red_kings, pos);
+    return red_turn ? opposite_piece_red(g, pos) : opposite_piece_black(g, pos);
 }
 
 /**
@@ -142,44 +273,11 @@ int opposite_piece(GameState *g, int pos, int red_turn) {
  * 2. Move the piece from 'from' to 'to' using clear_bit and set_bit
  * 3. If capture, remove the jumped opponent piece at the midpoint
  * 4. Check for and apply promotions
+ * Every bit that changes also gets XORed into g->hash
  */
 void move_piece(GameState *g, int from, int to) {
-    int is_red_turn = g->turn == 0;
-    int captured = (to - from == 14) || (to - from == 18) || (to - from == -14) || (to - from == -18);
-
-    if (is_red_turn) {
-        if (get_bit(g->red, from)) { 
-            g->red = clear_bit(g->red, from); g->red = set_bit(g->red, to); 
-        } else if (get_bit(g->red_kings, from)) { 
-            g->red_kings = clear_bit(g->red_kings, from); g->red_kings = set_bit(g->red_kings, to); 
-        }
-    } else {
-        if (get_bit(g->black, from)) { 
-            g->black = clear_bit(g->black, from); g->black = set_bit(g->black, to); 
-        } else if (get_bit(g->black_kings, from)) { 
-            g->black_kings = clear_bit(g->black_kings, from); g->black_kings = set_bit(g->black_kings, to); 
-        }
-    }
-
-    if (captured) {
-        int jumped = (from + to) / 2;
-        if (is_red_turn) {
-            if (get_bit(g->black, jumped)) {
-                g->black = clear_bit(g->black, jumped);
-            } else if (get_bit(g->black_kings, jumped)) {
-                g->black_kings = clear_bit(g->black_kings, jumped);
-            }
-        } else {
-            if (get_bit(g->red, jumped)) {
-                g->red = clear_bit(g->red, jumped);
-            }
-            else if (get_bit(g->red_kings, jumped)) {
-                 g->red_kings = clear_bit(g->red_kings, jumped);
-            }
-        }
-    }
-
-    promote(g);
+    if (g->turn == 0) move_piece_red(g, from, to);
+    else move_piece_black(g, from, to);
 }
 
 /**
@@ -187,26 +285,10 @@ void move_piece(GameState *g, int from, int to) {
  * Used to enforce mandatory consecutive jumps in checkers
  * Checks all four diagonal jump directions (14, 18, -14, -18)
  * Kings can jump in all directions, regular pieces only forward
+ * Directions 0, 1 go up the board and 2, 3 go down (see gen_tables.c), the tables already know the edges
  */
 int can_capture_again(GameState *g, int pos) {
-    int king = get_bit(g->red_kings, pos) || get_bit(g->black_kings, pos); // King check
-    int is_red_turn = g->turn == 0;
-
-    int directions[4] = {14, 18, -14, -18};
-    for (int i = 0; i < 4; i++) {
-        int diff = directions[i];
-        int to = pos + diff;
-        int over = (pos + to) / 2;
-
-        if (!on_board(to) || !dark_square(to)) continue;
-        if (occupied(g, to)) continue;
-
-        if (is_red_turn && !king && diff < 0) continue;   // red men only go up
-        if (!is_red_turn && !king && diff > 0) continue;  // black men only go down
-
-        if (opposite_piece(g, over, is_red_turn)) return 1;
-    }
-    return 0;
+    return g->turn == 0 ? can_capture_again_red(g, pos) : can_capture_again_black(g, pos);
 }
 
 /**
@@ -216,22 +298,7 @@ int can_capture_again(GameState *g, int pos) {
  * direction rules for non-kings, and presence of opponent piece to jump
  */
 int is_capture_move_valid(GameState *g, int from, int to) {
-    if (!on_board(from) || !on_board(to)) return 0;
-    if (!dark_square(to) || occupied(g, to)) return 0;
-
-    int diff = to - from;
-    if (!(abs(diff) == 14 || abs(diff) == 18)) return 0;
-
-    int red_turn = g->turn == 0;
-    int king = get_bit(g->red_kings, from) || get_bit(g->black_kings, from);
-
-    if (red_turn && !king && diff < 0) return 0;   // red men only go up
-    if (!red_turn && !king && diff > 0) return 0;  // black men only go down
-
-    int over = (from + to) / 2;
-    if (!opposite_piece(g, over, red_turn)) return 0;
-
-    return 1;
+    return g->turn == 0 ? is_capture_move_valid_red(g, from, to) : is_capture_move_valid_black(g, from, to);
 }
 
 /**
@@ -244,41 +311,92 @@ int is_capture_move_valid(GameState *g, int from, int to) {
  * -- Does NOT validate presence of opponent piece for captures --
  */
 int valid_move(GameState *g, int from, int to) {
-    if (!on_board(from) || !on_board(to)) return 0;
-    if (!dark_square(to) || occupied(g, to)) return 0;
-
-    int diff = to - from;
-    int red_turn = g->turn == 0;
-    int king = get_bit(g->red_kings, from) || get_bit(g->black_kings, from);
-
-    // simple steps and captures
-    if (red_turn) {
-        if (diff == 7 || diff == 9 || diff == 14 || diff == 18) return 1;
-        if (king && (diff == -7 || diff == -9 || diff == -14 || diff == -18)) return 1;
-    } else {
-        if (diff == -7 || diff == -9 || diff == -14 || diff == -18) return 1;
-        if (king && (diff == 7 || diff == 9 || diff == 14 || diff == 18)) return 1;
-    }
-    return 0;
+    return g->turn == 0 ? valid_move_red(g, from, to) : valid_move_black(g, from, to);
 }
 
+// ---------- MOVE GENERATION ----------
+
+#include "movegen.c" // generate_moves() - every legal move at once using whole board shifts
+#include "batchgen.c" // batch_movegen() - the same shifts over thousands of positions with AVX2/AVX-512
+
+// ---------- ENDGAME TABLEBASE ----------
+
+#include "tablebase.c" // tb_open()/tb_probe() - exact endgame results from an mmap'd file built by tbgen
+
+// ---------- POSITION RECORDS ----------
+
+#include "records.c" // pack_position()/record_file_open() - 16 byte positions in mmap'd files
+
+// ---------- OPENING BOOK ----------
+
+#include "book.c" // book_open()/book_probe() - known opening moves from an mmap'd file built by bookgen
+
+// ---------- COMPUTER PLAYER ----------
+
+#include "search.c" // search_position() - alpha-beta engine with a transposition table
+#include "mcts.c" // mcts_search() - Monte Carlo tree search, random playouts instead of alpha-beta
+
+// ---------- ENGINE PROTOCOL ----------
+
+#include "protocol.c" // protocol_loop() - ./checkers -p, line commands for controller programs
+
 // ---------- MAIN GAME LOOP ----------
 
+/**
+ * Could the piece on 'from', having already jumped the pieces in 'taken', go on to 'to' as part of
+ * legal move 'm'? A step only fits a step, a jump has to take one of m's pieces it hasn't taken yet,
+ * land on an empty square, and leave a way to take the rest and finish on m->to
+ */
+static int hop_fits(GameState *g, const Move *m, int from, int to, uint64_t taken) {
+    if (!m->captures) return !taken && m->from == from && m->to == to;
+    if ((taken == 0 && m->from != from) || (taken & ~m->captures)) return 0;
+    if (abs(to / 8 - from / 8) != 2 || abs(to % 8 - from % 8) != 2 || occupied(g, to)) return 0;
+    uint64_t over = 1ULL << ((from + to) / 2);
+    if (!(m->captures & ~taken & over)) return 0;
+    int path[13] = {to};
+    return jump_path(to, m->to, m->captures & ~taken & ~over, path, 1) != 0;
+}
+
+// Drop every move in 'list' the hop from 'from' to 'to' doesn't fit, returns how many are left
+// (the list stays as it was when none fit, so the human can try again)
+static int keep_matching(GameState *g, MoveList *list, int from, int to, uint64_t taken) {
+    int n = 0;
+    for (int i = 0; i < list->count; i++)
+        if (hop_fits(g, &list->moves[i], from, to, taken)) n++;
+    if (n == 0) return 0;
+    n = 0;
+    for (int i = 0; i < list->count; i++)
+        if (hop_fits(g, &list->moves[i], from, to, taken)) list->moves[n++] = list->moves[i];
+    return list->count = n;
+}
+
+// The jumps so far make a whole legal move: the piece is on its last square with all its pieces taken
+static int move_complete(const MoveList *list, int sq, uint64_t taken) {
+    for (int i = 0; i < list->count; i++)
+        if (list->moves[i].to == sq && list->moves[i].captures == taken) return 1;
+    return 0;
+}
+
 /**
  * Main game loop that handles all gameplay
  * 1. Display board and check for winner each turn
  * 2. Get move input from current player (format: from_row from_col to_row to_col)
- * 3. Validate and execute the move
- * 4. If capture was made, check for and handle consecutive jumps with same piece
+ * 3. Validate and execute the move - it has to be the start of one of the moves from generate_moves()
+ * 4. If capture was made, check for and handle consecutive jumps with same piece, each one matched
+ *    against those moves too (a jump is forced whenever one exists, and crowning ends the move)
  * 5. Switch turns after move is complete
  * Loop continues until game ends or player quits with -1
+ * If 'computer' is 0 (red) or 1 (black) the engine plays that side using 'limits', -1 = two humans
+ * With 'ponder' set the engine keeps searching the reply it expects while the human types theirs
+ * (see ponder_start() in search.c), so a correct guess answers sooner and from deeper
  * ---------------------------------------------------------------------------------
  * ---- SORRY FOR LITIGOUS COMMENTING IT HELPS WITH UNDERSTANDING PROCESS A LOT ----
  * ---------------------------------------------------------------------------------
  */
-void play_game() {
+void play_game(int computer, SearchLimits limits, int ponder) {
     GameState g;
     init_board(&g);
+    Ponder pondering = {0}; // background search on the human's time, only with 'ponder'
 
     while (1) {
         print_game(&g); // Print the entire board each time before the move (lets player see updates)
@@ -287,6 +405,34 @@ void play_game() {
         if (win == 1) { printf("Black wins!\n"); break; } // Don't waste time - black has all the pieces
         if (win == 2) { printf("Red wins!\n"); break; }   // Don't waste time - red has all the pieces
 
+        // Computer's turn - search, play the whole move (jumps included) and hand the turn back
+        if (g.turn == computer) {
+            Move bm;
+            if (book_probe(&g, &bm)) { // known opening, no need to think
+                ponder_stop(&pondering);
+                char text[MOVE_TEXT_SIZE];
+                move_to_text(&bm, text);
+                printf("Computer plays %d %d -> %d %d (book move %s)\n", bm.from / 8, bm.from % 8, bm.to / 8, bm.to % 8, text);
+                apply_move(&g, &bm);
+                switch_turn(&g);
+                continue;
+            }
+            SearchResult r = pondering.running ? ponder_finish(&pondering, &g, limits) : search_position(&g, limits);
+            if (!r.has_move) { printf("%s has no moves left. %s wins!\n", g.turn == 0 ? "Red" : "Black", g.turn == 0 ? "Black" : "Red"); break; }
+            printf("Computer plays %d %d -> %d %d (depth %d, score %d, %llu nodes, %.3f s%s)\n",
+                   r.best.from / 8, r.best.from % 8, r.best.to / 8, r.best.to % 8,
+                   r.depth, r.score, (unsigned long long)r.nodes, r.seconds, pondering.hit ? ", predicted your move" : "");
+            apply_move(&g, &r.best);
+            switch_turn(&g);
+            if (ponder) ponder_start(&pondering, &default_engine, &g, &r, limits); // think while the human does
+            continue;
+        }
+
+        MoveList list; // every legal move here - the human's input has to be the start of one of them
+        generate_moves(&g, &list);
+        if (list.count == 0) { printf("%s has no moves left. %s wins!\n", g.turn == 0 ? "Red" : "Black", g.turn == 0 ? "Black" : "Red"); break; }
+        int must_jump = list.moves[0].captures != 0; // Captures are forced - generate_moves() only gives jumps then
+
         int fr, fc, tr, tc; // Variables for FROM row/col and TO row/col
 
         // Print whose turn it is and ask for coordinates (example: 2 1 3 2)
@@ -309,23 +455,24 @@ void play_game() {
         int from = fr * 8 + fc;
         int to = tr * 8 + tc;
 
-        // Validate move using rules - checks direction, distance, kings, etc.
-        if (!valid_move(&g, from, to)) {
-            printf("Invalid move. Try again.\n"); // Invalid - not a legal checkers move
+        // Keep only the legal moves that start with this step/jump - none left means it isn't legal
+        int was_capture = (abs(to - from) == 14 || abs(to - from) == 18);
+        if (keep_matching(&g, &list, from, to, 0) == 0) {
+            if (must_jump && !was_capture) printf("You have a jump, you have to take it.\n"); // Error catch - captures are mandatory
+            else printf("Invalid move. Try again.\n"); // Invalid - not the start of any legal move
             continue; // Skip to next loop iteration
         }
 
-        // Determine if the move is a capture by checking distance (14 or 18 = jump)
-        int was_capture = (abs(to - from) == 14 || abs(to - from) == 18);
-
         // Actually perform the move (updates board, removes captured piece, promotes kings)
         move_piece(&g, from, to);
 
         // --- MULTI-JUMP HANDLING ---
-        // If the player just made a capture, check if the same piece can jump again
+        // If the player just made a capture, the same piece keeps jumping until one of the moves
+        // left is complete (generate_moves() only gives whole jumps, crowning already ends them)
         if (was_capture) {
             int cur_pos = to; // Track where that piece ended up
-            while (can_capture_again(&g, cur_pos)) { // While another jump is possible...
+            uint64_t taken = 1ULL << ((from + to) / 2); // pieces jumped so far
+            while (!move_complete(&list, cur_pos, taken)) { // While another jump is needed...
                 print_game(&g); // Reprint board so they can see the new position
                 printf("You can capture again with the same piece at (%d,%d). Enter next jump (row col): ",
                        cur_pos / 8, cur_pos % 8);
@@ -333,6 +480,7 @@ void play_game() {
                 int ntr, ntc; // new TO row/col
                 if (scanf("%d %d", &ntr, &ntc) != 2) { // If input fails, stop safely
                     printf("Input ended.\n");
+                    ponder_stop(&pondering);
                     return;
                 }
 
@@ -345,8 +493,8 @@ void play_game() {
                 // Convert new row/col to bit position
                 int next_to = ntr * 8 + ntc;
 
-                // Make sure the move is actually a valid *capture* from the same piece
-                if (!is_capture_move_valid(&g, cur_pos, next_to)) {
+                // Make sure this jump still fits one of the legal moves
+                if (keep_matching(&g, &list, cur_pos, next_to, taken) == 0) {
                     printf("That is not a valid capture from (%d,%d). Try again.\n",
                            cur_pos/8, cur_pos%8);
                     continue;
@@ -356,25 +504,65 @@ void play_game() {
                 move_piece(&g, cur_pos, next_to);
 
                 // Update the piece’s current position in case another jump is available
+                taken |= 1ULL << ((cur_pos + next_to) / 2);
                 cur_pos = next_to;
             }
         }
 
         // Once no more jumps are available, or it wasn’t a capture move,
         // switch to the other player's turn (0 ↔ 1)
-        g.turn = 1 - g.turn;
+        switch_turn(&g);
     }
+    ponder_stop(&pondering); // game over or quit - don't leave a search running
 }
 
+#ifndef CHECKERS_NO_MAIN // tools like perft.c include this file for the rules and bring their own main()
 /**
  * Entry point - just prints intro messages and starts play_game()
  * (User instructions are printed here once at startup)
+ * ./checkers              two players
+ * ./checkers -c [ms]      computer plays black, thinking ms milliseconds per move (default 1000)
+ * ./checkers -c [ms] -t n  same, searching with n threads
+ * ./checkers -c [ms] -ponder  same, and it keeps thinking while you do
+ * ./checkers -p           engine protocol for other programs, no prompts (see protocol.c)
  */
-int main() {
+int main(int argc, char **argv) {
+    int computer = -1, ponder = 0;
+    SearchLimits limits = {0, 1000, 1};
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-c") == 0) {
+            computer = 1;
+            if (i + 1 < argc && atoi(argv[i + 1]) > 0) limits.time_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            limits.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-ponder") == 0) {
+            ponder = 1;
+        } else if (strcmp(argv[i], "-p") == 0) { // headless, everything else gets set with commands
+            tb_open(TB_DEFAULT_FILE);
+            book_open(BOOK_DEFAULT_FILE);
+#ifdef CHECKERS_NN
+            nn_open(NN_DEFAULT_FILE);
+#endif
+            return protocol_loop();
+        }
+    }
+
     printf("Welcome to BitBoard Checkers!\n"); // Friendly intro
     printf("Move format: from_row from_col to_row to_col (0–7).\n"); // Explain how to move
     printf("Example: 1 0 2 1 moves piece from row1 col0 → row2 col1.\n"); // Example move
+    printf("If you can capture you have to, and a man that gets crowned ends its move.\n"); // Forced captures
     printf("After a capture, the same piece must continue jumping if possible.\n"); // Explain consecutive jump rule
-    play_game(); // Run the full game loop above
+    if (computer >= 0) printf("The computer plays Black%s%s.\n", limits.threads > 1 ? " (multi-threaded)" : "",
+                              ponder ? " and thinks on your time" : "");
+    if (computer >= 0 && tb_open(TB_DEFAULT_FILE)) // just an mmap, costs nothing if the file isn't there
+        printf("Endgame tablebase loaded (up to %d pieces).\n", tb.max_pieces);
+    if (computer >= 0 && book_open(BOOK_DEFAULT_FILE))
+        printf("Opening book loaded (%llu moves).\n", (unsigned long long)book.count);
+#ifdef CHECKERS_NN
+    if (computer >= 0 && nn_open(NN_DEFAULT_FILE)) // before play_game() sets up the board, so its accumulator uses these weights
+        printf("Neural network eval loaded (%s).\n", nn_backend_names[nn_backend]);
+#endif
+    play_game(computer, limits, ponder); // Run the full game loop above
     return 0; // Exit cleanly
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,401 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <zlib.h>
+#define CHECKERS_NO_MAIN // rules + search + records out of checkers.c, our own main()
+#include "checkers.c"
+
+/**
+ * Training data generator - plays engine games against itself on every core and writes sampled
+ * positions, each labelled with the search score and how the game ended, as gzipped record files
+ *
+ * Usage: ./datagen [-o prefix] [-n games] [-w workers] [-d depth] [-ms n] [-mb n] [-s seed] [-r random_plies]
+ *                  [-k every] [-g shard_games] [-z level]
+ *   -o prefix   files are prefix_000000.pos.gz, prefix_000001.pos.gz ... (default "selfplay")
+ *   -n games    (default 1000), -w workers = games played at once (default every core)
+ *   -d / -ms    search per move (default depth 6), -mb = each worker's table (default 16)
+ *   -s seed     (default 1) and -r random_plies (default 6) pick the openings, same seed = same openings
+ *   -k every    keep about 1 position in 'every' (default 4, neighbours in a game are nearly the same)
+ *   -g games    per file (default 1000), -z gzip level 1-9 (default 6)
+ *
+ * Every file is one gzip stream of a normal record file (records.c: header, then 16 byte records),
+ * so "zcat prefix_000003.pos.gz > x.pos" gives a file record_file_open() reads. In a record:
+ *   score    what the search said, from the side to move's point of view (RECORD_HAS_SCORE)
+ *   result   how the game ended: red won / black won / draw (RECORD_HAS_RESULT, record_result())
+ * Positions where the side to move has a capture are never kept (the score there is about the
+ * exchange, not the position), and neither are ones the search has already seen a forced win in
+ *
+ * Game threads never touch the disk: a finished game's records go into a bounded queue and one
+ * writer thread gathers them into files and compresses them. If the writer falls behind, the game
+ * threads wait on the queue rather than the queue growing without end
+ *
+ * Resuming: file k holds games k*g .. k*g+g-1, in game order, and only shows up under its real name
+ * once it's complete (written as .tmp, then renamed). Running the same command again skips every
+ * file that's already there, so a run that got killed or Ctrl-C'd picks up where it left off (games
+ * of files that weren't finished get played again). With a depth limit (no -ms) game n is always
+ * the same game, so a file comes out the same whichever run, and however many workers, wrote it
+ *
+ * Games end like arena's: no moves (lost), three times the same position, DATAGEN_QUIET_PLIES plies
+ * without a capture or a man moving, or DATAGEN_MAX_PLIES plies (draws)
+ */
+
+#define DATAGEN_MAX_PLIES 400
+#define DATAGEN_QUIET_PLIES 80
+#define DATAGEN_QUEUE_PER_WORKER 4
+
+typedef struct {
+    const char *prefix;
+    int games;
+    int workers;
+    int shard_games;        // games per file
+    int random_plies;
+    int sample_every;       // keep about 1 position in this many
+    int table_mb;
+    int level;              // gzip level
+    uint64_t seed;
+    SearchLimits limits;
+} DatagenConfig;
+
+typedef struct {
+    int games_played;       // this run
+    uint64_t positions;     // written this run
+    int shards_written;
+    int shards_skipped;     // already there from an earlier run
+    double seconds;
+    int stopped;            // 1 = datagen_stop() (or a write error) ended it early
+} DatagenStats;
+
+// One finished game, labelled and ready for its file
+typedef struct {
+    int game;
+    int count;
+    PackedPosition records[DATAGEN_MAX_PLIES];
+} GameBatch;
+
+// A file the writer is still collecting games for. Games come in any order, they go out in game order
+typedef struct {
+    int index;
+    int games;              // games this file gets (the last one can be short)
+    int received;
+    int *counts;            // per game in the file
+    PackedPosition **records;
+} OpenShard;
+
+static DatagenConfig dg;
+static char *shard_done;            // per file, already complete when the run started
+static int next_game;               // handed out to workers with an atomic add
+static int dg_stopping;             // __atomic, datagen_stop() can come from a signal
+static int producers_left;
+
+// Bounded queue of finished games, workers -> writer
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_not_full = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t queue_not_empty = PTHREAD_COND_INITIALIZER;
+static GameBatch *queue;
+static int queue_cap, queue_head, queue_count;
+
+// Ask a running datagen_run() to wrap up: no new games, the ones being played get dropped. Signal safe
+void datagen_stop(void) {
+    __atomic_store_n(&dg_stopping, 1, __ATOMIC_RELAXED);
+}
+
+static int stopping(void) { return __atomic_load_n(&dg_stopping, __ATOMIC_RELAXED); }
+
+static void shard_name(char *out, size_t size, int index, int tmp) {
+    snprintf(out, size, "%s_%06d.pos.gz%s", dg.prefix, index, tmp ? ".tmp" : "");
+}
+
+// ---------- GAMES ----------
+
+/**
+ * Play game number 'game' and put the positions it kept in 'b'. Returns 0 if it got dropped
+ * half way through because of datagen_stop()
+ */
+static int play_datagen_game(int game, Engine *engine, GameBatch *b) {
+    GameState g;
+    init_board(&g);
+    uint64_t rng = dg.seed * 0x9E3779B97F4A7C15ULL + (uint64_t)game;
+    tt_clear(&engine->tt); // no leftovers from the last game, game n plays the same every time
+    b->game = game;
+    b->count = 0;
+
+    static _Thread_local uint64_t seen[DATAGEN_MAX_PLIES + 1]; // hash after every ply, for repetitions
+    seen[0] = g.hash;
+    int quiet = 0, result = 0;
+
+    for (int ply = 0; ; ) {
+        if (stopping()) return 0;
+        MoveList list;
+        generate_moves(&g, &list);
+        if (list.count == 0) { result = g.turn == 0 ? -1 : 1; break; } // side to move lost
+
+        Move m;
+        if (ply < dg.random_plies) {
+            m = list.moves[splitmix64(&rng) % (uint64_t)list.count];
+        } else {
+            SearchResult r = engine_search(engine, &g, dg.limits);
+            m = r.best;
+            int known_win = r.score > WIN_SCORE - WIN_RANGE || r.score < -WIN_SCORE + WIN_RANGE;
+            if (!known_win && !list.moves[0].captures && splitmix64(&rng) % (uint64_t)dg.sample_every == 0)
+                b->records[b->count++] = pack_position(&g, 1, r.score); // captures are forced, so any move capturing = all do
+        }
+
+        uint64_t men = g.turn == 0 ? g.red : g.black;
+        quiet = m.captures || (men & (1ULL << m.from)) ? 0 : quiet + 1; // captures and men moving can't be undone
+        apply_move(&g, &m);
+        switch_turn(&g);
+        seen[++ply] = g.hash;
+
+        int repeats = 1;
+        for (int back = 2; back <= quiet; back += 2)
+            if (seen[ply - back] == g.hash) repeats++;
+        if (repeats >= 3 || quiet >= DATAGEN_QUIET_PLIES || ply >= DATAGEN_MAX_PLIES) break; // draw
+    }
+    for (int i = 0; i < b->count; i++) record_set_result(&b->records[i], result);
+    return 1;
+}
+
+static void *datagen_worker(void *arg) {
+    (void)arg;
+    Engine engine;
+    memset(&engine, 0, sizeof(engine));
+    GameBatch *b = malloc(sizeof(GameBatch));
+    int ok = b && tt_alloc(&engine.tt, dg.table_mb);
+    if (!ok) fprintf(stderr, "Out of memory for a worker.\n"); // Error catch - this worker sits out, the others play its games
+    while (ok && !stopping()) {
+        int game = __atomic_fetch_add(&next_game, 1, __ATOMIC_RELAXED);
+        if (game >= dg.games) break;
+        if (shard_done[game / dg.shard_games]) continue; // an earlier run already wrote it
+        if (!play_datagen_game(game, &engine, b)) break;
+
+        pthread_mutex_lock(&queue_lock);
+        while (queue_count == queue_cap) pthread_cond_wait(&queue_not_full, &queue_lock);
+        GameBatch *slot = &queue[(queue_head + queue_count) % queue_cap];
+        slot->game = b->game;
+        slot->count = b->count;
+        memcpy(slot->records, b->records, (size_t)b->count * sizeof(PackedPosition));
+        queue_count++;
+        pthread_cond_signal(&queue_not_empty);
+        pthread_mutex_unlock(&queue_lock);
+    }
+    engine_free(&engine);
+    free(b);
+    pthread_mutex_lock(&queue_lock);
+    producers_left--;
+    pthread_cond_signal(&queue_not_empty); // the writer might be waiting for a game that isn't coming
+    pthread_mutex_unlock(&queue_lock);
+    return NULL;
+}
+
+// ---------- WRITER ----------
+
+static void free_shard(OpenShard *s) {
+    for (int i = 0; i < s->games; i++) free(s->records[i]);
+    free(s->records);
+    free(s->counts);
+}
+
+// Compress a complete file to .tmp and rename it into place. Returns 0 if it didn't make it
+static int write_shard(OpenShard *s, uint64_t *positions) {
+    char tmp[1024], name[1024], mode[8];
+    shard_name(tmp, sizeof(tmp), s->index, 1);
+    shard_name(name, sizeof(name), s->index, 0);
+    snprintf(mode, sizeof(mode), "wb%d", dg.level);
+    gzFile f = gzopen(tmp, mode);
+    if (!f) return 0;
+    gzbuffer(f, 1 << 18);
+    RecordHeader h = {"BBCHKPOS", RECORD_VERSION, sizeof(PackedPosition)};
+    int ok = gzwrite(f, &h, sizeof(h)) == (int)sizeof(h);
+    for (int i = 0; i < s->games && ok; i++) {
+        unsigned bytes = (unsigned)s->counts[i] * sizeof(PackedPosition);
+        ok = bytes == 0 || gzwrite(f, s->records[i], bytes) == (int)bytes;
+        *positions += (uint64_t)s->counts[i];
+    }
+    if (gzclose(f) != Z_OK) ok = 0;
+    if (ok && rename(tmp, name) != 0) ok = 0;
+    if (!ok) remove(tmp);
+    return ok;
+}
+
+/**
+ * Takes games off the queue, files them under their shard, and writes every shard that's complete.
+ * Runs until every worker is done and the queue is empty. Whatever isn't complete by then (a stop)
+ * just gets dropped, the next run plays those games again
+ */
+static void datagen_writer(DatagenStats *stats, double start) {
+    OpenShard *open = NULL;
+    int open_count = 0, open_cap = 0;
+    uint64_t kept = 0; // positions in games that came in, for the progress line (files only count once written)
+    GameBatch *b = malloc(sizeof(GameBatch));
+    if (!b) { datagen_stop(); stats->stopped = 1; } // Error catch - nothing to take games with, so stop making them
+
+    while (1) {
+        pthread_mutex_lock(&queue_lock);
+        while (queue_count == 0 && producers_left > 0) pthread_cond_wait(&queue_not_empty, &queue_lock);
+        if (queue_count == 0) { pthread_mutex_unlock(&queue_lock); break; }
+        if (b) {
+            GameBatch *slot = &queue[queue_head];
+            b->game = slot->game;
+            b->count = slot->count;
+            memcpy(b->records, slot->records, (size_t)slot->count * sizeof(PackedPosition));
+        }
+        queue_head = (queue_head + 1) % queue_cap;
+        queue_count--;
+        pthread_cond_signal(&queue_not_full);
+        pthread_mutex_unlock(&queue_lock);
+        if (!b || stats->stopped) continue; // just draining so the workers can finish
+
+        int index = b->game / dg.shard_games, k = 0;
+        while (k < open_count && open[k].index != index) k++;
+        if (k == open_count) { // first game of this file
+            if (open_count == open_cap) {
+                int cap = open_cap * 2 + 4;
+                OpenShard *grown = realloc(open, (size_t)cap * sizeof(OpenShard));
+                if (!grown) { datagen_stop(); stats->stopped = 1; continue; } // Error catch - out of memory, stop
+                open = grown;
+                open_cap = cap;
+            }
+            OpenShard *s = &open[open_count];
+            s->index = index;
+            s->games = dg.games - index * dg.shard_games < dg.shard_games ? dg.games - index * dg.shard_games : dg.shard_games;
+            s->received = 0;
+            s->counts = calloc((size_t)s->games, sizeof(int));
+            s->records = calloc((size_t)s->games, sizeof(PackedPosition *));
+            if (!s->counts || !s->records) { free(s->counts); free(s->records); datagen_stop(); stats->stopped = 1; continue; }
+            open_count++;
+        }
+        OpenShard *s = &open[k];
+        int slot = b->game - index * dg.shard_games;
+        s->records[slot] = malloc((size_t)b->count * sizeof(PackedPosition) + 1); // +1: a game can keep nothing, and malloc(0) can be NULL
+        if (!s->records[slot]) { datagen_stop(); stats->stopped = 1; continue; } // Error catch - same
+        memcpy(s->records[slot], b->records, (size_t)b->count * sizeof(PackedPosition));
+        s->counts[slot] = b->count;
+        s->received++;
+        stats->games_played++;
+        kept += (uint64_t)b->count;
+
+        if (s->received == s->games) {
+            if (write_shard(s, &stats->positions)) stats->shards_written++;
+            else { // Error catch - disk full or gone, no point playing games nobody can keep
+                char name[1024];
+                shard_name(name, sizeof(name), s->index, 0);
+                fprintf(stderr, "\nCan't write %s, stopping.\n", name);
+                datagen_stop();
+                stats->stopped = 1;
+            }
+            free_shard(s);
+            open[k] = open[--open_count];
+        }
+        double seconds = (now_ms() - start) / 1000;
+        fprintf(stderr, "\r%d games  %llu positions  %.0f positions/s ", stats->games_played,
+                (unsigned long long)kept, seconds > 0 ? kept / seconds : 0.0);
+    }
+    for (int k = 0; k < open_count; k++) free_shard(&open[k]);
+    free(open);
+    free(b);
+}
+
+// ---------- RUN ----------
+
+/**
+ * Play cfg->games games (minus the ones whose files are already there) and write them out.
+ * Returns 1 if it could get going at all, with what happened in 'stats'
+ */
+int datagen_run(const DatagenConfig *cfg, DatagenStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    dg = *cfg;
+    if (dg.games < 1) dg.games = 1;
+    if (dg.workers < 1) dg.workers = 1;
+    if (dg.shard_games < 1) dg.shard_games = 1;
+    if (dg.sample_every < 1) dg.sample_every = 1;
+    if (dg.random_plies < 0) dg.random_plies = 0;
+    if (dg.level < 1 || dg.level > 9) dg.level = 6;
+    if (dg.table_mb < 1) dg.table_mb = 1;
+    if (dg.limits.max_depth <= 0 && dg.limits.time_ms <= 0) dg.limits.max_depth = 6; // Error catch - has to stop somehow
+    dg.limits.threads = 1; // the games are the parallelism
+
+    int shards = (dg.games + dg.shard_games - 1) / dg.shard_games;
+    shard_done = calloc((size_t)shards, 1);
+    queue_cap = dg.workers * DATAGEN_QUEUE_PER_WORKER;
+    queue = malloc((size_t)queue_cap * sizeof(GameBatch));
+    if (!shard_done || !queue) { free(shard_done); free(queue); return 0; }
+    for (int k = 0; k < shards; k++) {
+        char name[1024];
+        shard_name(name, sizeof(name), k, 0);
+        shard_done[k] = access(name, F_OK) == 0;
+        stats->shards_skipped += shard_done[k];
+    }
+
+    GameState g;
+    init_board(&g); // sets up the zobrist keys before any worker needs them
+    next_game = 0;
+    queue_head = queue_count = 0;
+    double start = now_ms();
+    pthread_t *ids = malloc((size_t)dg.workers * sizeof(pthread_t));
+    int started = 0;
+    pthread_mutex_lock(&queue_lock);
+    producers_left = dg.workers;
+    pthread_mutex_unlock(&queue_lock);
+    for (int w = 0; ids && w < dg.workers; w++, started++)
+        if (pthread_create(&ids[w], NULL, datagen_worker, NULL) != 0) break;
+    pthread_mutex_lock(&queue_lock);
+    producers_left -= dg.workers - started; // the ones that never started won't be saying they're done
+    pthread_mutex_unlock(&queue_lock);
+
+    if (started > 0) datagen_writer(stats, start);
+    for (int w = 0; w < started; w++) pthread_join(ids[w], NULL);
+    if (started > 0) fprintf(stderr, "\n");
+    stats->seconds = (now_ms() - start) / 1000;
+    if (stopping()) stats->stopped = 1;
+    __atomic_store_n(&dg_stopping, 0, __ATOMIC_RELAXED);
+    free(ids);
+    free(queue);
+    free(shard_done);
+    queue = NULL;
+    shard_done = NULL;
+    return started > 0;
+}
+
+#ifndef DATAGEN_NO_MAIN // test_datagen.c brings its own main()
+static void on_signal(int sig) { (void)sig; datagen_stop(); }
+
+int main(int argc, char **argv) {
+    DatagenConfig cfg = {"selfplay", 1000, (int)sysconf(_SC_NPROCESSORS_ONLN), 1000, 6, 4, 16, 6, 1, {6, 0, 1}};
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-o") == 0) cfg.prefix = argv[i + 1];
+        else if (strcmp(argv[i], "-n") == 0) cfg.games = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-w") == 0) cfg.workers = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-d") == 0) cfg.limits.max_depth = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-ms") == 0) { cfg.limits.time_ms = atoi(argv[i + 1]); cfg.limits.max_depth = 0; }
+        else if (strcmp(argv[i], "-mb") == 0) cfg.table_mb = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-s") == 0) cfg.seed = strtoull(argv[i + 1], NULL, 0);
+        else if (strcmp(argv[i], "-r") == 0) cfg.random_plies = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-k") == 0) cfg.sample_every = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-g") == 0) cfg.shard_games = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-z") == 0) cfg.level = atoi(argv[i + 1]);
+    }
+    if (tb_open(TB_DEFAULT_FILE)) printf("Endgame tablebase loaded (up to %d pieces).\n", tb.max_pieces);
+#ifdef CHECKERS_NN
+    if (nn_open(NN_DEFAULT_FILE)) printf("Neural network eval loaded (%s).\n", nn_backend_names[nn_backend]);
+#endif
+    printf("%d games into %s_*.pos.gz (%d per file), %d workers, seed %llu\n", cfg.games, cfg.prefix,
+           cfg.shard_games, cfg.workers, (unsigned long long)cfg.seed);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    DatagenStats st;
+    if (!datagen_run(&cfg, &st)) { printf("Out of memory.\n"); return 1; }
+    printf("%d games, %llu positions in %d new files (%d already done) in %.1f s\n", st.games_played,
+           (unsigned long long)st.positions, st.shards_written, st.shards_skipped, st.seconds);
+    if (st.stopped) printf("Stopped early - run the same command again to carry on.\n");
+    return st.stopped ? 1 : 0;
+}
+#endif
@@ -0,0 +1,65 @@
+/**
+ * Incremental evaluation - the static score of a position, kept in GameState.eval the same way
+ * zobrist.c keeps GameState.hash
+ *
+ * Included from checkers.c right after zobrist.c so move_piece(), promote() and apply_move() can
+ * update it as they go
+ *
+ * Every term is a per-square value, so the whole score is just the sum of eval_square[board][sq]
+ * over every piece. Moving a piece is eval += eval_square[b][to] - eval_square[b][from], a capture
+ * subtracts the captured piece's value and crowning swaps a man's value for a king's. Nobody has
+ * to count bits on the four boards at a leaf any more
+ *
+ * The score is always from red's point of view (evaluate() in search.c flips it for black), so
+ * switching the turn doesn't touch it. The terms, for a red piece (black is the same board turned
+ * around, negated):
+ *   material      men 100, kings 160
+ *   advancement   men further up the board are closer to crowning
+ *   back rank     men still on their own back row keep the other side from crowning there
+ *   center        pieces on the middle squares (rows 3-4, columns 2-5) control more of the board
+ *
+ * Compile with -DCHECKERS_DEBUG and CHECK_HASH() checks it against a full recompute too
+ */
+
+#define EVAL_MAN 100
+#define EVAL_KING 160
+#define EVAL_BACK_RANK 6
+#define EVAL_CENTER_MAN 4
+#define EVAL_CENTER_KING 8
+
+static const int eval_advance[8] = {0, 0, 2, 4, 8, 10, 12, 0}; // red man bonus by row (row 7 = already a king)
+
+static int eval_square[4][64]; // [Z_RED / Z_BLACK / Z_RED_KINGS / Z_BLACK_KINGS][square], red's point of view
+static int eval_ready = 0;
+
+void init_eval(void) {
+    if (eval_ready) return;
+    for (int sq = 0; sq < 64; sq++) {
+        int row = sq / 8, col = sq % 8;
+        int center = row >= 3 && row <= 4 && col >= 2 && col <= 5;
+        int man = EVAL_MAN + eval_advance[row] + (row == 0 ? EVAL_BACK_RANK : 0) + (center ? EVAL_CENTER_MAN : 0);
+        int king = EVAL_KING + (center ? EVAL_CENTER_KING : 0);
+        eval_square[Z_RED][sq] = man;
+        eval_square[Z_RED_KINGS][sq] = king;
+        eval_square[Z_BLACK][63 - sq] = -man;       // 63 - sq turns the board around, black's row 7 = red's row 0
+        eval_square[Z_BLACK_KINGS][63 - sq] = -king;
+    }
+    eval_ready = 1;
+}
+
+// Sum of the square values for every set bit in 'board'
+static int eval_board(uint64_t board, int which) {
+    int s = 0;
+    while (board) s += eval_square[which][pop_lsb(&board)];
+    return s;
+}
+
+/**
+ * Full recompute from the four boards, only for setting up a position and for the debug check -
+ * everything else updates g->eval incrementally
+ */
+int compute_eval(GameState *g) {
+    init_eval();
+    return eval_board(g->red, Z_RED) + eval_board(g->black, Z_BLACK)
+         + eval_board(g->red_kings, Z_RED_KINGS) + eval_board(g->black_kings, Z_BLACK_KINGS);
+}
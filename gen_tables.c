@@ -0,0 +1,60 @@
+#include <stdio.h>
+
+/**
+ * Generates board32_tables.h - the lookup tables between the 64 square board (row * 8 + col) and
+ * the 32 dark squares, and which dark square is next to which
+ *
+ * Build step, only needs rerunning if the board layout ever changes:
+ *   gcc -o gen_tables gen_tables.c && ./gen_tables > board32_tables.h
+ *
+ * Dark squares (row + col odd) get numbered 0-31 going up the board, left to right in each row,
+ * which is the same order pext(board, DARK_SQUARES) packs them in
+ */
+
+// Same direction order as dir_delta[] in movegen.c: up right, up left, down right, down left
+static const int drow[4] = {1, 1, -1, -1};
+static const int dcol[4] = {1, -1, 1, -1};
+
+static int dark_index[64];
+
+static int square(int row, int col) {
+    if (row < 0 || row > 7 || col < 0 || col > 7) return -1;
+    return dark_index[row * 8 + col] >= 0 ? dark_index[row * 8 + col] : -1;
+}
+
+static void print_neighbors(const char *name, const char *what, int dist, int rows[32], int cols[32]) {
+    printf("\n// %s\nstatic const int8_t %s[32][4] = {\n", what, name);
+    for (int d = 0; d < 32; d++) {
+        printf("    {");
+        for (int i = 0; i < 4; i++)
+            printf("%3d%s", square(rows[d] + drow[i] * dist, cols[d] + dcol[i] * dist), i < 3 ? "," : "");
+        printf("}%s // %d\n", d < 31 ? "," : " ", d);
+    }
+    printf("};\n");
+}
+
+int main(void) {
+    int rows[32], cols[32], n = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        int row = sq / 8, col = sq % 8;
+        if ((row + col) % 2 == 1) { rows[n] = row; cols[n] = col; dark_index[sq] = n++; }
+        else dark_index[sq] = -1;
+    }
+
+    printf("// Generated by gen_tables.c - don't edit, rerun: ./gen_tables > board32_tables.h\n");
+    printf("\n// row * 8 + col -> dark square 0-31, -1 for light squares\nstatic const int8_t square_to_dark[64] = {\n");
+    for (int sq = 0; sq < 64; sq++)
+        printf("%s%3d%s", sq % 8 == 0 ? "    " : "", dark_index[sq], sq == 63 ? "\n" : sq % 8 == 7 ? ",\n" : ",");
+    printf("};\n");
+
+    printf("\n// dark square 0-31 -> row * 8 + col\nstatic const uint8_t dark_to_square[32] = {\n");
+    for (int d = 0; d < 32; d++)
+        printf("%s%2d%s", d % 4 == 0 ? "    " : "", rows[d] * 8 + cols[d], d == 31 ? "\n" : d % 4 == 3 ? ",\n" : ", ");
+    printf("};\n");
+
+    print_neighbors("dark_step", "Dark square one step away in each direction (up right, up left, down right, down left), -1 = off the board",
+                    1, rows, cols);
+    print_neighbors("dark_jump", "Landing square of a jump in each direction (the piece jumped is dark_step[][] the same way), -1 = off the board",
+                    2, rows, cols);
+    return 0;
+}
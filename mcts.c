@@ -0,0 +1,424 @@
+/**
+ * Monte Carlo tree search - the other way to pick a move: instead of searching every line to a
+ * depth and scoring the leaves, play lots of random games to the end and count who wins
+ *
+ * Included from checkers.c after search.c (uses its clock and thread limits)
+ *
+ * One playout:
+ *   1. selection   walk down the tree from the root, at each node taking the child with the best
+ *                  UCT value: its win rate + MCTS_UCT_C * sqrt(ln(parent visits) / visits). Moves
+ *                  that win get played more, moves nobody has tried much still get a look
+ *   2. expansion   a leaf that's been reached MCTS_EXPAND_VISITS times gets a child per legal move
+ *   3. playout     random moves from there to the end of the game (mcts_playout())
+ *   4. backup      every node on the path adds the result, from the side that moved into it
+ * The answer is the root child played the most
+ *
+ * Nodes all come out of one pool allocated up front (mcts_alloc()): a node's children are a block
+ * of consecutive nodes, handed out with an atomic add, so a search never calls malloc. When the
+ * pool is full the tree just stops growing and the playouts carry on from the leaves
+ *
+ * Threads share the one tree (tree parallelism), no locks:
+ *   - visits go up on the way DOWN (virtual loss): a node another thread is in the middle of
+ *     looks like it lost one more game, so the next thread usually picks something else. The
+ *     result gets added on the way back up
+ *   - a leaf gets expanded by whichever thread flips it from MCTS_LEAF to MCTS_EXPANDING first,
+ *     everyone else just plays out from it until the children are published (MCTS_EXPANDED)
+ *
+ * The playouts don't use GameState or generate_moves() at all: every step is the shift/mask
+ * move sets from batchgen.c, one random pick out of them (no list of moves is ever built) and a
+ * crowning mask like promote()'s. No hash, no score, no branches on the direction or the side
+ */
+
+#define MCTS_UCT_C 1.0
+#define MCTS_EXPAND_VISITS 4        // playouts through a leaf before it gets children (keeps the pool for the good lines)
+#define MCTS_MAX_DEPTH 128          // deepest the tree walk goes, past that it's all playout
+#define MCTS_PLAYOUT_PLIES 200      // a random game still going after this many plies counts as a draw
+#define MCTS_DEFAULT_MB 64
+
+enum { MCTS_LEAF = 0, MCTS_EXPANDING, MCTS_EXPANDED };
+
+typedef struct {
+    uint32_t captures;      // the move into this node: captured squares as a 32 square set (to_dark32())
+    uint8_t from, to, crowns;
+    uint8_t state;          // MCTS_LEAF / MCTS_EXPANDING / MCTS_EXPANDED
+    int32_t first_child;    // children are nodes[first_child .. first_child + child_count - 1]
+    int32_t child_count;
+    int32_t visits;         // playouts through here, including ones still running (virtual loss)
+    int64_t score;          // 2 per win + 1 per draw, for the side that played the move into this node
+} MctsNode;
+
+_Static_assert(sizeof(MctsNode) == 32, "two nodes per cache line");
+
+// What the caller wants: stop after this many playouts or this many milliseconds, whichever comes first
+typedef struct {
+    int playouts;   // 0 = only the time limit counts
+    int time_ms;    // 0 = only the playout limit counts
+    int threads;    // threads sharing the tree, 0 or 1 = just the caller's thread
+} MctsLimits;
+
+typedef struct {
+    Move best;          // move to play (only valid if has_move)
+    int has_move;
+    double win_rate;    // of the best move, for the side to move (0..1, draws count half)
+    int visits;         // playouts through the best move
+    uint64_t playouts;  // all of them
+    int tree_nodes;     // pool nodes in use at the end
+    double seconds;
+} MctsResult;
+
+typedef struct {
+    MctsNode *nodes;
+    int32_t capacity;
+    int32_t used;
+    int stop;
+    uint64_t playouts;  // finished, all threads
+    MctsLimits limits;
+    GameState root;
+    double start;
+} MctsTree;
+
+/**
+ * Allocate the node pool
+ * Returns 0 if the memory isn't there
+ */
+int mcts_alloc(MctsTree *t, int megabytes) {
+    memset(t, 0, sizeof(*t));
+    size_t count = (size_t)megabytes * 1024 * 1024 / sizeof(MctsNode);
+    if (count < 2 || count > INT32_MAX) return 0;
+    t->nodes = malloc(count * sizeof(MctsNode));
+    if (!t->nodes) return 0;
+    t->capacity = (int32_t)count;
+    return 1;
+}
+
+void mcts_free(MctsTree *t) {
+    free(t->nodes);
+    memset(t, 0, sizeof(*t));
+}
+
+// ---------- PLAYOUTS ----------
+
+// Just the pieces, [0] = red, [1] = black
+typedef struct {
+    uint64_t men[2], kings[2];
+} PlayoutBoard;
+
+static const int playout_delta[4] = {9, 7, -7, -9};    // same order as dir_delta
+static const uint64_t playout_crown[2] = {0xFF00000000000000ULL, 0x00000000000000FFULL};
+
+/**
+ * Move the piece on 'from' to 'to' for side 's', whichever kind it is, and crown it if it got there
+ * as a man. Returns 1 if it was crowned (which ends a jump sequence)
+ */
+static inline int playout_move(PlayoutBoard *b, int s, int from, int to) {
+    uint64_t both = (1ULL << from) | (1ULL << to);
+    uint64_t king = 0 - ((b->kings[s] >> from) & 1); // all 1s if it's a king
+    b->kings[s] ^= both & king;
+    b->men[s] ^= both & ~king;
+    uint64_t crowned = b->men[s] & playout_crown[s];  // promote(), without the hash and score
+    b->men[s] ^= crowned;
+    b->kings[s] |= crowned;
+    return crowned != 0;
+}
+
+/**
+ * The playout code, stamped out twice like the rules helpers: a portable copy that goes through
+ * bitops.c's popcount()/pdep(), and one compiled for POPCNT + BMI2 with the instructions inline
+ * (a playout is nothing but popcounts, so a function pointer call for each one costs more than
+ * the rest of the move). mcts_playout() picks the copy the CPU can run
+ *
+ * Per copy:
+ *
+ * playout_jumps_X() / playout_steps_X() - landing squares of every single jump / step the pieces
+ * have, one mask per direction (the same shifts as batch_one()) and how many in each. 't' is all
+ * 1s when black is moving. Returns how many there are in all
+ *
+ * playout_pick_X() - random one of the 'count' squares spread over to[0..3], sets *dir. Which
+ * direction = how many running totals the random number is past (compares, not ifs), which
+ * square = pdep of a single bit into that direction's mask
+ *
+ * playout_step_X() - one random legal move for side 's', played: a jump (continued as long as
+ * the piece can, crowning stops it) if there is one, otherwise a step. Steps and first jumps get
+ * played by the same masked code (k = 1 for a jump: the piece came from 2 squares back and the
+ * one in between comes off), only a multi-jump loops. Returns 0 if 's' has no moves. 'captured'
+ * gets the squares jumped (0 for a step) and 'last' the square the piece ended on, only for
+ * checking the moves (the playout ignores them)
+ *
+ * mcts_playout_X() - random game from 'b' with 'turn' to move until someone can't move. Returns
+ * the winner: 0 red, 1 black, 2 = still going after MCTS_PLAYOUT_PLIES (draw)
+ */
+#define PLAYOUT_FOR_TARGET(suffix, TARGET, POPCOUNT, PDEP) \
+\
+TARGET static inline int playout_jumps_##suffix(uint64_t men, uint64_t kings, uint64_t enemy, uint64_t empty, uint64_t t, uint64_t *to, int *c) { \
+    uint64_t up = kings | (men & ~t), down = kings | (men & t); \
+    to[0] = ((((up & NOT_COL_67) << 9) & enemy) << 9) & empty; \
+    to[1] = ((((up & NOT_COL_01) << 7) & enemy) << 7) & empty; \
+    to[2] = ((((down & NOT_COL_67) >> 7) & enemy) >> 7) & empty; \
+    to[3] = ((((down & NOT_COL_01) >> 9) & enemy) >> 9) & empty; \
+    for (int d = 0; d < 4; d++) c[d] = POPCOUNT(to[d]); \
+    return c[0] + c[1] + c[2] + c[3]; \
+} \
+\
+TARGET static inline int playout_steps_##suffix(uint64_t men, uint64_t kings, uint64_t empty, uint64_t t, uint64_t *to, int *c) { \
+    uint64_t up = kings | (men & ~t), down = kings | (men & t); \
+    to[0] = ((up & NOT_COL_7) << 9) & empty; \
+    to[1] = ((up & NOT_COL_0) << 7) & empty; \
+    to[2] = ((down & NOT_COL_7) >> 7) & empty; \
+    to[3] = ((down & NOT_COL_0) >> 9) & empty; \
+    for (int d = 0; d < 4; d++) c[d] = POPCOUNT(to[d]); \
+    return c[0] + c[1] + c[2] + c[3]; \
+} \
+\
+TARGET static inline int playout_pick_##suffix(const uint64_t *to, const int *c, int count, uint64_t *rng, int *dir) { \
+    uint32_t r = (uint32_t)(((splitmix64(rng) & 0xFFFFFFFFULL) * (uint64_t)count) >> 32); /* 0..count-1 without a divide */ \
+    int before[4] = {0, c[0], c[0] + c[1], c[0] + c[1] + c[2]}; \
+    int d = (r >= (uint32_t)before[1]) + (r >= (uint32_t)before[2]) + (r >= (uint32_t)before[3]); \
+    *dir = d; \
+    return __builtin_ctzll(PDEP(1ULL << (r - (uint32_t)before[d]), to[d])); \
+} \
+\
+TARGET static int playout_step_##suffix(PlayoutBoard *b, int s, uint64_t *rng, uint64_t *captured, int *last) { \
+    int o = s ^ 1; \
+    uint64_t t = 0 - (uint64_t)s; \
+    uint64_t enemy = b->men[o] | b->kings[o]; \
+    uint64_t empty = ~(b->men[s] | b->kings[s] | enemy); \
+    uint64_t to[4]; \
+    int c[4], dir; \
+    int count = playout_jumps_##suffix(b->men[s], b->kings[s], enemy, empty, t, to, c); \
+    int k = count != 0; /* captures are forced */ \
+    uint64_t km = 0 - (uint64_t)k; \
+    if (!k) count = playout_steps_##suffix(b->men[s], b->kings[s], empty, t, to, c); \
+    if (count == 0) return 0; \
+    int sq = playout_pick_##suffix(to, c, count, rng, &dir); \
+    int over = sq - playout_delta[dir]; \
+    uint64_t gone = (1ULL << over) & km; /* the piece jumped, nothing for a step */ \
+    b->men[o] &= ~gone; \
+    b->kings[o] &= ~gone; \
+    *captured = gone; \
+    *last = sq; \
+    if (playout_move(b, s, over - playout_delta[dir] * k, sq) || !k) return 1; /* crowned or a step, move over */ \
+    while (1) { /* keep jumping with the same piece while it can */ \
+        uint64_t piece = 1ULL << sq; \
+        enemy = b->men[o] | b->kings[o]; \
+        empty = ~(b->men[s] | b->kings[s] | enemy); \
+        count = playout_jumps_##suffix(b->men[s] & piece, b->kings[s] & piece, enemy, empty, t, to, c); \
+        if (count == 0) return 1; \
+        int from = sq; \
+        sq = playout_pick_##suffix(to, c, count, rng, &dir); \
+        over = sq - playout_delta[dir]; \
+        b->men[o] &= ~(1ULL << over); \
+        b->kings[o] &= ~(1ULL << over); \
+        *captured |= 1ULL << over; \
+        *last = sq; \
+        if (playout_move(b, s, from, sq)) return 1; \
+    } \
+} \
+\
+TARGET static int mcts_playout_##suffix(PlayoutBoard b, int turn, uint64_t *rng) { \
+    uint64_t captured; \
+    int last; \
+    for (int ply = 0; ply < MCTS_PLAYOUT_PLIES; ply++, turn ^= 1) \
+        if (!playout_step_##suffix(&b, turn, rng, &captured, &last)) return turn ^ 1; \
+    return 2; \
+}
+
+PLAYOUT_FOR_TARGET(portable, , popcount, pdep)
+#if BITOPS_X86
+#define PLAYOUT_HW 1
+PLAYOUT_FOR_TARGET(hw, __attribute__((target("popcnt,bmi2"))), __builtin_popcountll, _pdep_u64)
+#else
+#define PLAYOUT_HW 0
+#endif
+
+static int playout_hw = 0; // 1 = the CPU has POPCNT and BMI2
+
+// Runs before main(), same as init_bitops()
+__attribute__((constructor)) static void init_playout(void) {
+#if PLAYOUT_HW
+    __builtin_cpu_init();
+    playout_hw = __builtin_cpu_supports("popcnt") && __builtin_cpu_supports("bmi2");
+#endif
+}
+
+// The copy of the playout this CPU can run
+static int mcts_playout(PlayoutBoard b, int turn, uint64_t *rng) {
+#if PLAYOUT_HW
+    if (playout_hw) return mcts_playout_hw(b, turn, rng);
+#endif
+    return mcts_playout_portable(b, turn, rng);
+}
+
+// ---------- TREE ----------
+
+static inline Move mcts_node_move(const MctsNode *n) {
+    Move m = {n->from, n->to, n->crowns, from_dark32(n->captures)};
+    return m;
+}
+
+/**
+ * Children for 'node' (position 'pos'), if this thread gets to do it and the pool has room
+ * The state only goes to MCTS_EXPANDED after the children are written, other threads
+ * don't look at them before that
+ */
+static void mcts_expand(MctsTree *t, int32_t node, GameState *pos) {
+    MctsNode *n = &t->nodes[node];
+    uint8_t leaf = MCTS_LEAF;
+    if (!__atomic_compare_exchange_n(&n->state, &leaf, MCTS_EXPANDING, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return;
+    MoveList list;
+    generate_moves(pos, &list);
+    int32_t first = __atomic_fetch_add(&t->used, list.count, __ATOMIC_RELAXED);
+    if (first > t->capacity - list.count) { // Error catch - pool's full, this one stays a leaf for good
+        __atomic_store_n(&t->used, t->capacity, __ATOMIC_RELAXED);
+        return;
+    }
+    for (int i = 0; i < list.count; i++) {
+        MctsNode *c = &t->nodes[first + i];
+        memset(c, 0, sizeof(*c));
+        c->from = list.moves[i].from;
+        c->to = list.moves[i].to;
+        c->crowns = list.moves[i].crowns;
+        c->captures = to_dark32(list.moves[i].captures);
+    }
+    n->first_child = first;
+    n->child_count = list.count;
+    __atomic_store_n(&n->state, MCTS_EXPANDED, __ATOMIC_RELEASE);
+}
+
+/**
+ * log() and sqrt() for UCT, close enough for picking a child and no libm (so checkers.c still
+ * builds without -lm)
+ * log: exponent * ln 2 + a short series for the mantissa (x >= 1 here)
+ * sqrt: halve the exponent for a first guess, then Newton
+ */
+static double mcts_log(double x) {
+    union { double d; uint64_t u; } v = {x};
+    int e = (int)((v.u >> 52) & 0x7FF) - 1023;
+    v.u = (v.u & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL; // mantissa, 1 <= m < 2
+    double t = (v.d - 1) / (v.d + 1), t2 = t * t;
+    return e * 0.6931471805599453 + 2 * t * (1 + t2 * (1.0 / 3 + t2 * (1.0 / 5 + t2 / 7)));
+}
+
+static double mcts_sqrt(double x) {
+    if (x <= 0) return 0;
+    union { double d; uint64_t u; } v = {x};
+    v.u = (v.u >> 1) + 0x1FF8000000000000ULL;
+    double y = v.d;
+    for (int i = 0; i < 3; i++) y = 0.5 * (y + x / y);
+    return y;
+}
+
+// Child of 'node' with the best UCT value, unvisited ones first
+static int32_t mcts_select(MctsTree *t, const MctsNode *n) {
+    int32_t best = n->first_child;
+    double best_value = -1;
+    double log_visits = mcts_log((double)__atomic_load_n(&n->visits, __ATOMIC_RELAXED) + 1);
+    for (int32_t c = n->first_child; c < n->first_child + n->child_count; c++) {
+        int32_t visits = __atomic_load_n(&t->nodes[c].visits, __ATOMIC_RELAXED);
+        if (visits == 0) return c;
+        double value = (double)__atomic_load_n(&t->nodes[c].score, __ATOMIC_RELAXED) / (2.0 * visits)
+                     + MCTS_UCT_C * mcts_sqrt(log_visits / visits);
+        if (value > best_value) { best_value = value; best = c; }
+    }
+    return best;
+}
+
+// One selection + expansion + playout + backup
+static void mcts_iteration(MctsTree *t, uint64_t *rng) {
+    GameState pos = t->root;
+    int32_t path[MCTS_MAX_DEPTH + 1];
+    int depth = 0;
+    path[0] = 0;
+    __atomic_fetch_add(&t->nodes[0].visits, 1, __ATOMIC_RELAXED);
+
+    while (1) {
+        MctsNode *n = &t->nodes[path[depth]];
+        uint8_t state = __atomic_load_n(&n->state, __ATOMIC_ACQUIRE);
+        if (state == MCTS_LEAF && depth < MCTS_MAX_DEPTH &&
+            (depth == 0 || __atomic_load_n(&n->visits, __ATOMIC_RELAXED) > MCTS_EXPAND_VISITS)) {
+            mcts_expand(t, path[depth], &pos);
+            state = __atomic_load_n(&n->state, __ATOMIC_ACQUIRE);
+        }
+        if (state != MCTS_EXPANDED || n->child_count == 0 || depth == MCTS_MAX_DEPTH) break;
+        int32_t c = mcts_select(t, n);
+        __atomic_fetch_add(&t->nodes[c].visits, 1, __ATOMIC_RELAXED); // virtual loss until the result is in
+        Move m = mcts_node_move(&t->nodes[c]);
+        apply_move(&pos, &m);
+        switch_turn(&pos);
+        path[++depth] = c;
+    }
+
+    PlayoutBoard b = {{pos.red, pos.black}, {pos.red_kings, pos.black_kings}};
+    int winner = mcts_playout(b, pos.turn, rng);
+
+    // node 'depth' has pos.turn to move, so the one that moved into it is the other side
+    for (int d = depth, mover = pos.turn ^ 1; d >= 0; d--, mover ^= 1) {
+        int64_t result = winner == 2 ? 1 : winner == mover ? 2 : 0;
+        __atomic_fetch_add(&t->nodes[path[d]].score, result, __ATOMIC_RELAXED);
+    }
+}
+
+typedef struct {
+    MctsTree *tree;
+    int id;     // 0 = the caller's thread, watches the clock
+} MctsWorker;
+
+static void *mcts_thread(void *arg) {
+    MctsTree *t = ((MctsWorker *)arg)->tree;
+    int id = ((MctsWorker *)arg)->id;
+    uint64_t rng = 0x9E3779B97F4A7C15ULL * (uint64_t)(id + 1) ^ (uint64_t)t->start;
+    for (uint64_t i = 0; !__atomic_load_n(&t->stop, __ATOMIC_RELAXED); i++) {
+        mcts_iteration(t, &rng);
+        uint64_t done = __atomic_add_fetch(&t->playouts, 1, __ATOMIC_RELAXED);
+        if (t->limits.playouts > 0 && done >= (uint64_t)t->limits.playouts) __atomic_store_n(&t->stop, 1, __ATOMIC_RELAXED);
+        if (id == 0 && (i & 63) == 0 && t->limits.time_ms > 0 && now_ms() - t->start >= t->limits.time_ms)
+            __atomic_store_n(&t->stop, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+/**
+ * Pick a move for the side to move in 'g' with tree 't' (g is not changed)
+ * The tree starts over every call. Needs a playout or time limit
+ */
+MctsResult mcts_search(MctsTree *t, GameState *g, MctsLimits limits) {
+    MctsResult result;
+    memset(&result, 0, sizeof(result));
+    if (!t->nodes && !mcts_alloc(t, MCTS_DEFAULT_MB)) return result; // Error catch - no memory for the pool
+    if (limits.playouts <= 0 && limits.time_ms <= 0) limits.playouts = 10000; // Error catch - has to stop somehow
+    MoveList list;
+    generate_moves(g, &list);
+    if (list.count == 0) return result; // nothing to play
+
+    t->root = *g;
+    t->limits = limits;
+    t->start = now_ms();
+    t->stop = 0;
+    t->playouts = 0;
+    t->used = 1;
+    memset(&t->nodes[0], 0, sizeof(MctsNode));
+
+    int threads = limits.threads < 1 ? 1 : limits.threads > MAX_THREADS ? MAX_THREADS : limits.threads;
+    pthread_t ids[MAX_THREADS];
+    MctsWorker workers[MAX_THREADS];
+    int started = 1;
+    for (int i = 0; i < threads; i++) workers[i] = (MctsWorker){t, i};
+    for (int i = 1; i < threads; i++, started++)
+        if (pthread_create(&ids[i], NULL, mcts_thread, &workers[i]) != 0) break; // Error catch - go with what we have
+    mcts_thread(&workers[0]);
+    for (int i = 1; i < started; i++) pthread_join(ids[i], NULL);
+
+    const MctsNode *root = &t->nodes[0];
+    if (root->state == MCTS_EXPANDED && root->child_count > 0) {
+        const MctsNode *best = &t->nodes[root->first_child];
+        for (int32_t c = root->first_child; c < root->first_child + root->child_count; c++)
+            if (t->nodes[c].visits > best->visits) best = &t->nodes[c];
+        result.best = mcts_node_move(best);
+        result.has_move = 1;
+        result.visits = best->visits;
+        result.win_rate = best->visits ? (double)best->score / (2.0 * best->visits) : 0.5;
+    }
+    result.playouts = t->playouts;
+    result.tree_nodes = t->used < t->capacity ? t->used : t->capacity;
+    result.seconds = (now_ms() - t->start) / 1000.0;
+    return result;
+}
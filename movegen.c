@@ -0,0 +1,411 @@
+/**
+ * Set-wise move generation
+ *
+ * Included from checkers.c right after the rules helpers, so GameState, move_piece() and
+ * the rest of the rules (and their _red/_black copies) are already defined when this file gets pulled in
+ *
+ * Instead of asking valid_move() about every (from, to) pair, we shift the whole side's
+ * bitboard one diagonal at a time. One shift + AND gives every piece that can step in that
+ * direction, two shifts + ANDs give every piece that can jump in that direction
+ *
+ *   +9 = up right    +7 = up left    -7 = down right    -9 = down left
+ *   (jumps are just the same direction twice: +18, +14, -14, -18)
+ *
+ * The edge masks stop pieces on column 0/7 from wrapping around to the other side of the board
+ */
+
+#define MAX_MOVES 128 // way more than any real position has, even with a pile of kings
+
+#define NOT_COL_0    0xFEFEFEFEFEFEFEFEULL // pieces that can go one column left
+#define NOT_COL_7    0x7F7F7F7F7F7F7F7FULL // pieces that can go one column right
+#define NOT_COL_01   0xFCFCFCFCFCFCFCFCULL // pieces that can go two columns left
+#define NOT_COL_67   0x3F3F3F3F3F3F3F3FULL // pieces that can go two columns right
+
+// One move for the side to move, a jump sequence counts as a single move
+typedef struct {
+    uint8_t from;       // square the piece starts on (row * 8 + col)
+    uint8_t to;         // square the piece ends on
+    uint8_t crowns;     // 1 if a man becomes a king by the end of the move
+    uint64_t captures;  // every square jumped over, 0 for a simple step
+} Move;
+
+typedef struct {
+    Move moves[MAX_MOVES];
+    int count;
+} MoveList;
+
+// The four diagonals, in order: up right, up left, down right, down left
+static const int dir_delta[4] = {9, 7, -7, -9};
+static const uint64_t step_edge[4] = {NOT_COL_7, NOT_COL_0, NOT_COL_7, NOT_COL_0};
+static const uint64_t jump_edge[4] = {NOT_COL_67, NOT_COL_01, NOT_COL_67, NOT_COL_01};
+
+/**
+ * Shift a whole board one diagonal step, positive deltas go up the board (left shift)
+ * and negative deltas go down (right shift)
+ */
+static inline uint64_t shift_dir(uint64_t board, int delta) {
+    return delta > 0 ? board << delta : board >> -delta;
+}
+
+// Red goes up the board (positive deltas), black goes down (negative deltas)
+static inline int forward_dir(int red_turn, int i) {
+    return red_turn ? dir_delta[i] > 0 : dir_delta[i] < 0;
+}
+
+static inline void add_move(MoveList *list, int from, int to, int crowns, uint64_t captures) {
+    if (list->count >= MAX_MOVES) return; // Error catch - never happens in a real game
+    Move *m = &list->moves[list->count++];
+    m->from = (uint8_t)from;
+    m->to = (uint8_t)to;
+    m->crowns = (uint8_t)crowns;
+    m->captures = captures;
+}
+
+/**
+ * generate_moves() and the jump search under it, stamped out once per side like the rules
+ * helpers (RULES_FOR_SIDE() in checkers.c): the mover's boards, which diagonals are forward and
+ * the crowning row are all constants in each copy, g->turn only gets looked at once
+ *
+ * Per copy:
+ *
+ * jumpers_X() - every piece of the side to move that has at least one jump
+ *
+ * steppers_X() - same for a plain step (only matters when there's no jump)
+ *
+ * jump_dfs_X() - depth first over every way the piece on 'sq' can keep jumping, on nothing but
+ * bitboards passed down by value (no GameState copies, no allocation, the recursion is at most
+ * 12 hops deep). Each branch that can't go any further is one complete move with everything it
+ * captured. A captured piece comes off the board as soon as it's jumped (same as move_piece()), so
+ * it can't be taken twice. A man that reaches the crowning row stops there, crowning ends the move
+ *
+ * generate_captures_X() / generate_moves_X() - see generate_captures() / generate_moves() below
+ */
+#define MOVEGEN_FOR_SIDE(side, RED_TURN, MEN, KINGS, EMEN, EKINGS, CROWN_ROW) \
+\
+static inline uint64_t jumpers_##side(GameState *g) { \
+    uint64_t men = g->MEN, kings = g->KINGS; \
+    uint64_t enemy = g->EMEN | g->EKINGS; \
+    uint64_t empty = ~(men | kings | enemy); \
+    uint64_t found = 0; \
+    for (int i = 0; i < 4; i++) { \
+        int d = dir_delta[i]; \
+        uint64_t movers = forward_dir(RED_TURN, i) ? (men | kings) : kings; \
+        uint64_t lands = shift_dir(shift_dir(movers & jump_edge[i], d) & enemy, d) & empty; \
+        found |= shift_dir(lands, -2 * d); /* back to where the jumps start */ \
+    } \
+    return found; \
+} \
+\
+static inline uint64_t steppers_##side(GameState *g) { \
+    uint64_t men = g->MEN, kings = g->KINGS; \
+    uint64_t empty = ~(men | kings | g->EMEN | g->EKINGS); \
+    uint64_t found = 0; \
+    for (int i = 0; i < 4; i++) { \
+        int d = dir_delta[i]; \
+        uint64_t movers = forward_dir(RED_TURN, i) ? (men | kings) : kings; \
+        found |= shift_dir(shift_dir(movers & step_edge[i], d) & empty, -d); \
+    } \
+    return found; \
+} \
+\
+static void jump_dfs_##side(MoveList *list, int from, int sq, int king, uint64_t enemy, uint64_t empty, uint64_t captures) { \
+    uint64_t piece = 1ULL << sq; \
+    int went_on = 0; \
+    for (int i = 0; i < 4; i++) { \
+        if (!king && !forward_dir(RED_TURN, i)) continue; /* men only jump forward */ \
+        int d = dir_delta[i]; \
+        uint64_t over = shift_dir(piece & jump_edge[i], d) & enemy; \
+        uint64_t land = shift_dir(over, d) & empty; \
+        if (!land) continue; \
+        went_on = 1; \
+        if (!king && (land & (CROWN_ROW))) { add_move(list, from, sq + 2 * d, 1, captures | over); continue; } \
+        jump_dfs_##side(list, from, sq + 2 * d, king, enemy & ~over, (empty | piece | over) & ~land, captures | over); \
+    } \
+    if (!went_on && captures) add_move(list, from, sq, 0, captures); \
+} \
+\
+static int generate_captures_##side(GameState *g, MoveList *list) { \
+    uint64_t enemy = g->EMEN | g->EKINGS; \
+    uint64_t empty = ~(g->MEN | g->KINGS | enemy); \
+    uint64_t starts = jumpers_##side(g); \
+    list->count = 0; \
+    while (starts) { \
+        int sq = pop_lsb(&starts); \
+        jump_dfs_##side(list, sq, sq, get_bit(g->KINGS, sq), enemy, empty, 0); \
+    } \
+    return list->count; \
+} \
+\
+static void generate_moves_##side(GameState *g, MoveList *list) { \
+    if (generate_captures_##side(g, list)) return; /* captures are forced */ \
+    uint64_t men = g->MEN, kings = g->KINGS; \
+    uint64_t empty = ~(men | kings | g->EMEN | g->EKINGS); \
+    for (int i = 0; i < 4; i++) { \
+        int d = dir_delta[i]; \
+        uint64_t movers = forward_dir(RED_TURN, i) ? (men | kings) : kings; /* kings go both ways */ \
+        uint64_t steps = shift_dir(movers & step_edge[i], d) & empty; \
+        while (steps) { \
+            int to = pop_lsb(&steps); \
+            add_move(list, to - d, to, get_bit(men, to - d) && get_bit(CROWN_ROW, to), 0); \
+        } \
+    } \
+}
+
+MOVEGEN_FOR_SIDE(red, 1, red, red_kings, black, black_kings, TOP_ROW)
+MOVEGEN_FOR_SIDE(black, 0, black, black_kings, red, red_kings, BOTTOM_ROW)
+
+/**
+ * Fill 'list' with every complete capture the side to move has: one Move per jump sequence,
+ * from the starting square to where the piece finally stops, with every square it jumped over
+ * Returns how many there are (0 = no jump anywhere, list is empty)
+ */
+int generate_captures(GameState *g, MoveList *list) {
+    STAT_INC(MOVEGEN);
+    STAT_TIMER_START(MOVEGEN);
+    int count = g->turn == 0 ? generate_captures_red(g, list) : generate_captures_black(g, list);
+    STAT_TIMER_STOP(MOVEGEN);
+    return count;
+}
+
+// Does the side to move have a jump somewhere? (then it has to take one)
+int has_capture(GameState *g) {
+    return (g->turn == 0 ? jumpers_red(g) : jumpers_black(g)) != 0;
+}
+
+// Does the side to move have a plain step somewhere? (with no jump either it has no moves = lost)
+int has_step(GameState *g) {
+    return (g->turn == 0 ? steppers_red(g) : steppers_black(g)) != 0;
+}
+
+/**
+ * Fill 'list' with every move the side to move can make
+ * Captures are forced: if there's any jump the list is just the jumps (generate_captures()),
+ * otherwise it's every simple step
+ *
+ * For each of the four diagonals:
+ *   steps = shift(movers, d) & empty                 -> every piece that can step that way
+ *   jumps = shift(shift(movers, d) & enemy, d) & empty -> every piece that can jump that way
+ * then we just walk the set bits of the results to get (from, to) pairs
+ *
+ * Matches what play_game() lets a player do
+ */
+void generate_moves(GameState *g, MoveList *list) {
+    STAT_INC(MOVEGEN);
+    STAT_TIMER_START(MOVEGEN);
+    if (g->turn == 0) generate_moves_red(g, list);
+    else generate_moves_black(g, list);
+    STAT_TIMER_STOP(MOVEGEN);
+}
+
+/**
+ * Play a move from generate_moves() straight onto the bitboards
+ * Multi-jumps go in one shot: the piece jumps from 'from' to 'to' and every captured square
+ * gets cleared out of both enemy boards at once
+ * Like move_piece() it does NOT switch the turn, the caller does that (switch_turn())
+ */
+void apply_move(GameState *g, const Move *m) {
+    uint64_t from = 1ULL << m->from, to = 1ULL << m->to;
+    int red_turn = g->turn == 0;
+    uint64_t *men = red_turn ? &g->red : &g->black;
+    uint64_t *kings = red_turn ? &g->red_kings : &g->black_kings;
+    int z_men = red_turn ? Z_RED : Z_BLACK, z_kings = red_turn ? Z_RED_KINGS : Z_BLACK_KINGS;
+    STAT_INC(APPLY_MOVE);
+    STAT_ADD(CAPTURES, popcount(m->captures));
+    STAT_ADD(PROMOTIONS, m->crowns);
+
+    if (*kings & from) { // kings just slide over (a king can jump in a loop and land where it started)
+        *kings = (*kings & ~from) | to;
+        g->hash ^= zobrist_keys[z_kings][m->from] ^ zobrist_keys[z_kings][m->to];
+        g->eval += eval_square[z_kings][m->to] - eval_square[z_kings][m->from];
+        NN_SUB(g, z_kings, m->from); NN_ADD(g, z_kings, m->to);
+    } else {
+        *men &= ~from;
+        if (m->crowns) *kings |= to; else *men |= to;
+        g->hash ^= zobrist_keys[z_men][m->from] ^ zobrist_keys[m->crowns ? z_kings : z_men][m->to];
+        g->eval += eval_square[m->crowns ? z_kings : z_men][m->to] - eval_square[z_men][m->from];
+        NN_SUB(g, z_men, m->from); NN_ADD(g, m->crowns ? z_kings : z_men, m->to);
+    }
+
+    if (m->captures) {
+        uint64_t *enemy_men = red_turn ? &g->black : &g->red;
+        uint64_t *enemy_kings = red_turn ? &g->black_kings : &g->red_kings;
+        int z_enemy_men = red_turn ? Z_BLACK : Z_RED, z_enemy_kings = red_turn ? Z_BLACK_KINGS : Z_RED_KINGS;
+        g->hash ^= hash_board(*enemy_men & m->captures, z_enemy_men)
+                 ^ hash_board(*enemy_kings & m->captures, z_enemy_kings);
+        g->eval -= eval_board(*enemy_men & m->captures, z_enemy_men)
+                 + eval_board(*enemy_kings & m->captures, z_enemy_kings);
+#ifdef CHECKERS_NN
+        for (uint64_t c = m->captures; c; ) {
+            int sq = pop_lsb(&c);
+            NN_SUB(g, get_bit(*enemy_kings, sq) ? z_enemy_kings : z_enemy_men, sq);
+        }
+#endif
+        *enemy_men &= ~m->captures;
+        *enemy_kings &= ~m->captures;
+    }
+    CHECK_HASH(g);
+}
+
+/**
+ * Undo record for make_move()/unmake_move() - everything needed to put a move back, so a search
+ * can walk the whole tree on one GameState instead of copying it at every ply
+ * Works for multi-jumps too since all the captured squares sit in one mask
+ */
+typedef struct {
+    uint64_t moved;           // from ^ to of the piece that moved (0 if a king jumped in a loop back home)
+    uint64_t captured;        // every enemy piece taken
+    uint64_t captured_kings;  // the ones out of 'captured' that were kings
+    uint64_t hash;            // g->hash before the move, so we never un-XOR anything
+    int eval;                 // g->eval before the move, same idea
+    uint64_t promoted;        // square the man got crowned on, 0 if the move didn't crown anything
+} Undo;
+
+/**
+ * Play a whole move AND switch the turn, filling 'u' so unmake_move() can take it back
+ */
+void make_move(GameState *g, Move m, Undo *u) {
+    uint64_t enemy_kings = g->turn == 0 ? g->black_kings : g->red_kings;
+    u->moved = (1ULL << m.from) ^ (1ULL << m.to);
+    u->captured = m.captures;
+    u->captured_kings = m.captures & enemy_kings;
+    u->hash = g->hash;
+    u->eval = g->eval;
+    u->promoted = m.crowns ? 1ULL << m.to : 0;
+
+    apply_move(g, &m);
+    switch_turn(g);
+}
+
+/**
+ * Take back the last make_move() - the side that moved is the one NOT on turn right now
+ */
+void unmake_move(GameState *g, const Undo *u) {
+    int red_moved = g->turn == 1;
+    uint64_t *men = red_moved ? &g->red : &g->black;
+    uint64_t *kings = red_moved ? &g->red_kings : &g->black_kings;
+    uint64_t *enemy_men = red_moved ? &g->black : &g->red;
+    uint64_t *enemy_kings = red_moved ? &g->black_kings : &g->red_kings;
+
+#ifdef CHECKERS_NN
+    { // the hash and eval come back from the Undo, the accumulator has to be walked back (before the boards change)
+        int z_men = red_moved ? Z_RED : Z_BLACK, z_kings = red_moved ? Z_RED_KINGS : Z_BLACK_KINGS;
+        int z_enemy_men = red_moved ? Z_BLACK : Z_RED, z_enemy_kings = red_moved ? Z_BLACK_KINGS : Z_RED_KINGS;
+        if (u->promoted) {
+            NN_SUB(g, z_kings, lsb_index(u->promoted)); NN_ADD(g, z_men, lsb_index(u->moved ^ u->promoted));
+        } else if (u->moved) { // of the two 'moved' squares, 'to' is the one with the piece on it now
+            uint64_t to = u->moved & (*men | *kings);
+            int which = *men & to ? z_men : z_kings;
+            NN_SUB(g, which, lsb_index(to)); NN_ADD(g, which, lsb_index(u->moved ^ to));
+        }
+        for (uint64_t c = u->captured; c; ) {
+            int sq = pop_lsb(&c);
+            NN_ADD(g, get_bit(u->captured_kings, sq) ? z_enemy_kings : z_enemy_men, sq);
+        }
+    }
+#endif
+
+    if (u->promoted) { // the new king goes back to being a man on 'from' (moved ^ to = from, even if from == to)
+        *kings &= ~u->promoted;
+        *men |= u->moved ^ u->promoted;
+    } else if (*men & u->moved) {
+        *men ^= u->moved; // XOR clears 'to' and sets 'from' in one go
+    } else {
+        *kings ^= u->moved;
+    }
+
+    *enemy_men |= u->captured & ~u->captured_kings;
+    *enemy_kings |= u->captured_kings;
+
+    g->turn = 1 - g->turn;
+    g->hash = u->hash;
+    g->eval = u->eval;
+    CHECK_HASH(g);
+}
+
+// ---------- MOVE NOTATION ----------
+
+/**
+ * Standard checkers notation numbers the 32 dark squares 1-32, row by row starting from the back row
+ * of the side that moves first (red here, the books call it "black"). So 1-4 is our row 0, 5-8 row 1...
+ * A move is "11-15", a jump "15x24", and a multi-jump can list every landing square "15x24x31"
+ */
+int square_number(int sq) {
+    return sq / 8 * 4 + (sq % 8) / 2 + 1;
+}
+
+// Square number 1-32 -> row * 8 + col (-1 if it's not 1-32)
+int number_square(int n) {
+    if (n < 1 || n > 32) return -1;
+    int row = (n - 1) / 4;
+    return row * 8 + 2 * ((n - 1) % 4) + (row % 2 ? 0 : 1); // even rows start on column 1, odd rows on column 0
+}
+
+#define MOVE_TEXT_SIZE 40 // longest move text + 1: 12 jumps = 13 squares and 12 'x's
+
+// Landing squares of a jump sequence from 'sq' that takes exactly the pieces in 'left' and ends on 'to',
+// into path[len..]. Returns the full length, 0 if there's no such sequence
+static int jump_path(int sq, int to, uint64_t left, int *path, int len) {
+    if (!left) return sq == to ? len : 0;
+    for (int d = 0; d < 4; d++) {
+        int dr = d < 2 ? 1 : -1, dc = d % 2 ? 1 : -1;
+        int row = sq / 8 + 2 * dr, col = sq % 8 + 2 * dc;
+        if (row < 0 || row > 7 || col < 0 || col > 7) continue;
+        int over = sq + 8 * dr + dc, land = row * 8 + col;
+        if (!(left & (1ULL << over)) || (left & (1ULL << land))) continue; // has to take one of them, can't land on one
+        path[len] = land;
+        int n = jump_path(land, to, left & ~(1ULL << over), path, len + 1);
+        if (n) return n;
+    }
+    return 0;
+}
+
+/**
+ * "11-15" / "15x24", and a multi-jump lists every landing square "15x24x31" - two different
+ * sequences can start and end on the same squares, only the whole path says which one it is
+ * 'out' needs room for MOVE_TEXT_SIZE chars
+ */
+void move_to_text(const Move *m, char *out) {
+    int path[13];
+    path[0] = m->from;
+    int len = popcount(m->captures) > 1 ? jump_path(m->from, m->to, m->captures, path, 1) : 0;
+    if (len == 0) { // a step or a single jump
+        sprintf(out, "%d%c%d", square_number(m->from), m->captures ? 'x' : '-', square_number(m->to));
+        return;
+    }
+    out += sprintf(out, "%d", square_number(path[0]));
+    for (int i = 1; i < len; i++) out += sprintf(out, "x%d", square_number(path[i]));
+}
+
+/**
+ * Find the legal move 'text' means in position 'g'
+ * Landing squares in the middle of a multi-jump pick out which captures were made, without them
+ * the first legal move with the same start and end square gets used
+ * Returns 1 and fills 'out', or 0 if it's not a legal move here (or not a move at all)
+ */
+int parse_move(GameState *g, const char *text, Move *out) {
+    int path[16], len = 0;
+    const char *p = text;
+    while (len < 16) {
+        char *end;
+        long n = strtol(p, &end, 10);
+        if (end == p || number_square((int)n) < 0) return 0; // Error catch - not a square number
+        path[len++] = number_square((int)n);
+        if (*end != '-' && *end != 'x' && *end != 'X') break;
+        p = end + 1;
+    }
+    if (len < 2) return 0;
+
+    uint64_t captures = 0; // only known when every landing square is there
+    for (int i = 1; len > 2 && i < len; i++) captures |= 1ULL << ((path[i - 1] + path[i]) / 2);
+
+    MoveList list;
+    generate_moves(g, &list);
+    for (int i = 0; i < list.count; i++) {
+        Move *m = &list.moves[i];
+        if (m->from != path[0] || m->to != path[len - 1]) continue;
+        if (len > 2 && m->captures != captures) continue;
+        *out = *m;
+        return 1;
+    }
+    return 0;
+}
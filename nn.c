@@ -0,0 +1,237 @@
+/**
+ * Neural network evaluation - a small quantized net in place of the hand written score, for
+ * builds with -DCHECKERS_NN and a weights file (checkers.nn)
+ *
+ * Included from checkers.c before GameState (GameState gets the accumulator from here)
+ *
+ * The net, all integers:
+ *   input   128 features: 4 boards (same order as the zobrist keys) x 32 dark squares, 1 = piece there
+ *   layer 1 128 -> NN_HIDDEN int16 weights. This is the accumulator: since only a couple of inputs
+ *           change per move, it lives in GameState.nn_acc and every move just adds/subtracts the
+ *           weight rows of the pieces that moved, got captured or got crowned (NN_ADD/NN_SUB, right
+ *           next to the hash and eval updates). Nobody ever does the full 128 x NN_HIDDEN multiply
+ *           except when a position gets set up
+ *   layer 2 clamp(acc, 0, 127) as uint8 -> NN_L2 with int8 weights, int32 sums, >> NN_L2_SHIFT, clamp 0..127
+ *   output  NN_L2 -> 1 with int8 weights, / NN_OUT_DIV = score from red's point of view
+ * Layer 2 is the only real work per eval: AVX2 does it with maddubs (uint8 x int8 pairs), the
+ * scalar version is the reference and gets used on CPUs without AVX2. Both give the same number
+ *
+ * Without CHECKERS_NN none of this is in GameState and NN_ADD/NN_SUB/NN_REFRESH are ((void)0).
+ * With it but no weights loaded the accumulator still gets kept (all zeros) and evaluate() uses
+ * the normal score
+ *
+ * Weights file: NNHeader, then w1, b1, w2, b2, w3, b3 exactly as laid out in NNWeights (little endian)
+ */
+
+#define NN_INPUTS 128       // 4 boards x 32 dark squares
+#define NN_HIDDEN 128       // accumulator size
+#define NN_L2 32
+#define NN_L2_SHIFT 6
+#define NN_OUT_DIV 16
+#define NN_VERSION 1
+#define NN_DEFAULT_FILE "checkers.nn"
+
+typedef struct {
+    char magic[8];          // "BBCHKNN"
+    uint32_t version;       // NN_VERSION
+    uint32_t inputs, hidden, l2;    // has to match NN_INPUTS / NN_HIDDEN / NN_L2
+} NNHeader;
+
+typedef struct {
+    _Alignas(32) int16_t w1[NN_INPUTS][NN_HIDDEN];  // one row per feature, added to the accumulator
+    _Alignas(32) int16_t b1[NN_HIDDEN];             // the accumulator of an empty board
+    _Alignas(32) int8_t w2[NN_L2][NN_HIDDEN];
+    int32_t b2[NN_L2];
+    int8_t w3[NN_L2];
+    int32_t b3;
+} NNWeights;
+
+static NNWeights nn_net;    // all zeros until nn_open() loads something
+static int nn_loaded = 0;
+
+// Board (Z_RED...) + square -> input number. A dark square's number 0-31 is just sq / 2
+static inline int nn_feature(int which, int sq) { return which * 32 + (sq >> 1); }
+
+// ---------- KERNELS ----------
+
+static void nn_add_scalar(int16_t *acc, const int16_t *w) { for (int i = 0; i < NN_HIDDEN; i++) acc[i] += w[i]; }
+static void nn_sub_scalar(int16_t *acc, const int16_t *w) { for (int i = 0; i < NN_HIDDEN; i++) acc[i] -= w[i]; }
+
+static int nn_clamp127(int v) { return v < 0 ? 0 : v > 127 ? 127 : v; }
+
+// Output layer, shared by both versions (NN_L2 multiplies, not worth vectorizing)
+static int nn_output(const int32_t *l2) {
+    int32_t out = nn_net.b3;
+    for (int j = 0; j < NN_L2; j++) out += nn_clamp127(l2[j] >> NN_L2_SHIFT) * nn_net.w3[j];
+    return out / NN_OUT_DIV;
+}
+
+static int nn_forward_scalar(const int16_t *acc) {
+    uint8_t h[NN_HIDDEN];
+    for (int i = 0; i < NN_HIDDEN; i++) h[i] = (uint8_t)nn_clamp127(acc[i]);
+    int32_t l2[NN_L2];
+    for (int j = 0; j < NN_L2; j++) {
+        int32_t s = nn_net.b2[j];
+        for (int i = 0; i < NN_HIDDEN; i++) s += h[i] * nn_net.w2[j][i];
+        l2[j] = s;
+    }
+    return nn_output(l2);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NN_X86 1
+
+__attribute__((target("avx2")))
+static void nn_add_avx2(int16_t *acc, const int16_t *w) {
+    for (int i = 0; i < NN_HIDDEN; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(acc + i));
+        _mm256_storeu_si256((__m256i *)(acc + i), _mm256_add_epi16(a, _mm256_load_si256((const __m256i *)(w + i))));
+    }
+}
+
+__attribute__((target("avx2")))
+static void nn_sub_avx2(int16_t *acc, const int16_t *w) {
+    for (int i = 0; i < NN_HIDDEN; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(acc + i));
+        _mm256_storeu_si256((__m256i *)(acc + i), _mm256_sub_epi16(a, _mm256_load_si256((const __m256i *)(w + i))));
+    }
+}
+
+/**
+ * Clamp + pack the accumulator to uint8 32 at a time, then every layer 2 row is 4 maddubs
+ * (uint8 x int8 -> pairs summed into int16, at most 2 x 127 x 127 so it can't saturate) and a
+ * madd against 1s to widen to int32
+ */
+__attribute__((target("avx2")))
+static int nn_forward_avx2(const int16_t *acc) {
+    const __m256i zero = _mm256_setzero_si256(), top = _mm256_set1_epi16(127), ones = _mm256_set1_epi16(1);
+    __m256i h[NN_HIDDEN / 32];
+    for (int k = 0; k < NN_HIDDEN / 32; k++) {
+        __m256i a = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i *)(acc + 32 * k)), zero), top);
+        __m256i b = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i *)(acc + 32 * k + 16)), zero), top);
+        h[k] = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8); // packus works per 128 bit half, put the order back
+    }
+    int32_t l2[NN_L2];
+    for (int j = 0; j < NN_L2; j++) {
+        __m256i sum = zero;
+        for (int k = 0; k < NN_HIDDEN / 32; k++) {
+            __m256i p = _mm256_maddubs_epi16(h[k], _mm256_load_si256((const __m256i *)(nn_net.w2[j] + 32 * k)));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(p, ones));
+        }
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+        l2[j] = nn_net.b2[j] + _mm_cvtsi128_si32(s);
+    }
+    return nn_output(l2);
+}
+#else
+#define NN_X86 0
+#endif
+
+enum { NN_SCALAR = 0, NN_AVX2 = 1 };
+const char *const nn_backend_names[2] = {"scalar", "avx2"};
+static int nn_backend = NN_SCALAR;
+
+/**
+ * Pick scalar or AVX2 (if the CPU has it), returns the one actually in use
+ * Safe to switch any time, both keep the accumulator exactly the same
+ */
+int set_nn_backend(int which) {
+    int best = NN_SCALAR;
+#if NN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) best = NN_AVX2;
+#endif
+    nn_backend = which < best ? which : best;
+    return nn_backend;
+}
+
+// Runs before main(), same as init_bitops()
+__attribute__((constructor)) static void init_nn(void) {
+    set_nn_backend(NN_AVX2);
+}
+
+static inline void nn_add(int16_t *acc, int feature) {
+#if NN_X86
+    if (nn_backend == NN_AVX2) { nn_add_avx2(acc, nn_net.w1[feature]); return; }
+#endif
+    nn_add_scalar(acc, nn_net.w1[feature]);
+}
+
+static inline void nn_sub(int16_t *acc, int feature) {
+#if NN_X86
+    if (nn_backend == NN_AVX2) { nn_sub_avx2(acc, nn_net.w1[feature]); return; }
+#endif
+    nn_sub_scalar(acc, nn_net.w1[feature]);
+}
+
+// Score from red's point of view for an up to date accumulator
+int nn_forward(const int16_t *acc) {
+#if NN_X86
+    if (nn_backend == NN_AVX2) return nn_forward_avx2(acc);
+#endif
+    return nn_forward_scalar(acc);
+}
+
+// Full accumulator from the four boards (setting up a position, and the debug check)
+void nn_refresh(int16_t *acc, uint64_t red, uint64_t black, uint64_t red_kings, uint64_t black_kings) {
+    uint64_t boards[4] = {red, black, red_kings, black_kings}; // Z_RED, Z_BLACK, Z_RED_KINGS, Z_BLACK_KINGS
+    memcpy(acc, nn_net.b1, sizeof(nn_net.b1));
+    for (int b = 0; b < 4; b++)
+        while (boards[b]) nn_add(acc, nn_feature(b, pop_lsb(&boards[b])));
+}
+
+/**
+ * Load a weights file. Returns 1 if it's loaded, 0 if it isn't there or doesn't fit this net
+ * (positions set up before this have a stale accumulator, so load first, then set up positions)
+ */
+int nn_open(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    NNHeader h;
+    static NNWeights w; // 37 KB, off the stack
+    int ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, "BBCHKNN", 8) == 0 && h.version == NN_VERSION &&
+             h.inputs == NN_INPUTS && h.hidden == NN_HIDDEN && h.l2 == NN_L2 &&
+             fread(w.w1, sizeof(w.w1), 1, f) == 1 && fread(w.b1, sizeof(w.b1), 1, f) == 1 &&
+             fread(w.w2, sizeof(w.w2), 1, f) == 1 && fread(w.b2, sizeof(w.b2), 1, f) == 1 &&
+             fread(w.w3, sizeof(w.w3), 1, f) == 1 && fread(&w.b3, sizeof(w.b3), 1, f) == 1;
+    fclose(f);
+    if (!ok) return 0; // Error catch - not a weights file, or one for a different size of net
+    nn_net = w;
+    nn_loaded = 1;
+    return 1;
+}
+
+// Write 'w' as a weights file nn_open() can read (for training tools). Returns 0 if it couldn't
+int nn_save(const char *path, const NNWeights *w) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return 0;
+    NNHeader h = {"BBCHKNN", NN_VERSION, NN_INPUTS, NN_HIDDEN, NN_L2};
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+             fwrite(w->w1, sizeof(w->w1), 1, f) == 1 && fwrite(w->b1, sizeof(w->b1), 1, f) == 1 &&
+             fwrite(w->w2, sizeof(w->w2), 1, f) == 1 && fwrite(w->b2, sizeof(w->b2), 1, f) == 1 &&
+             fwrite(w->w3, sizeof(w->w3), 1, f) == 1 && fwrite(&w->b3, sizeof(w->b3), 1, f) == 1;
+    if (fclose(f) != 0) ok = 0;
+    return ok;
+}
+
+#ifdef CHECKERS_NN
+#define NN_ADD(g, which, sq) nn_add((g)->nn_acc, nn_feature(which, sq))
+#define NN_SUB(g, which, sq) nn_sub((g)->nn_acc, nn_feature(which, sq))
+#define NN_REFRESH(g) nn_refresh((g)->nn_acc, (g)->red, (g)->black, (g)->red_kings, (g)->black_kings)
+// Debug build (with CHECKERS_DEBUG): the accumulator has to match a full recompute, called from CHECK_HASH()
+#define NN_CHECK(g) do { \
+        int16_t nn_full[NN_HIDDEN]; \
+        nn_refresh(nn_full, (g)->red, (g)->black, (g)->red_kings, (g)->black_kings); \
+        if (memcmp(nn_full, (g)->nn_acc, sizeof(nn_full)) != 0) { \
+            fprintf(stderr, "NN accumulator mismatch in %s\n", __func__); \
+            abort(); \
+        } \
+    } while (0)
+#else
+#define NN_ADD(g, which, sq) ((void)0)
+#define NN_SUB(g, which, sq) ((void)0)
+#define NN_REFRESH(g) ((void)0)
+#define NN_CHECK(g) ((void)0)
+#endif
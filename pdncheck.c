@@ -0,0 +1,400 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define CHECKERS_NO_MAIN // rules out of checkers.c, our own main()
+#include "checkers.c"
+
+/**
+ * PDN checker - replays every game in PDN files through the rules and reports the illegal ones
+ *
+ * Usage: ./pdncheck [-t threads] [-e errors_to_show] file.pdn...     (- = stdin, default every core, 20 errors)
+ *
+ * Every move gets matched against generate_moves(), so it's held to the same rules as the engine:
+ * captures are forced, a jump has to go on while the piece can still take more, and crowning ends
+ * it. Short jumps like "15x31" that skip the middle landing squares match every complete jump with
+ * the same start and end (see Replay for when there's two)
+ *
+ * Memory stays the same no matter how big the file is: it gets read CHUNK_SIZE bytes at a time,
+ * each chunk is cut at the last game boundary (the bit after gets carried into the next one) and
+ * handed to a worker through a queue with room for only a few chunks. A game boundary is a tag line
+ * "[..." right after move text, so a game is never split between two workers
+ *
+ * Inside a chunk a game also ends at its result (1-0, 0-1, 1/2-1/2, *, and the draughts 2-0/0-2/1-1),
+ * so files with no tags at all (just move text) work too. [FEN "..."] tags set the start position
+ */
+
+#define CHUNK_SIZE (4 << 20)
+#define QUEUE_SLOTS 8
+
+typedef struct {
+    char *data;
+    size_t len;
+    uint64_t offset;    // where data[0] is in the file, for error messages
+} Chunk;
+
+// Bounded queue of chunks between the reader and the workers
+static Chunk queue[QUEUE_SLOTS];
+static int queue_head = 0, queue_count = 0, queue_done = 0;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_not_empty = PTHREAD_COND_INITIALIZER, queue_not_full = PTHREAD_COND_INITIALIZER;
+
+// Totals, added to once per chunk
+static pthread_mutex_t totals_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t total_games = 0, total_moves = 0, bad_games = 0;
+static int errors_to_show = 20, errors_shown = 0;
+static const char *current_file = "";
+static int workers_running = 0;  // 0 = no threads came up, the reader checks chunks itself
+
+static void queue_push(Chunk c) {
+    pthread_mutex_lock(&queue_lock);
+    while (queue_count == QUEUE_SLOTS) pthread_cond_wait(&queue_not_full, &queue_lock);
+    queue[(queue_head + queue_count) % QUEUE_SLOTS] = c;
+    queue_count++;
+    pthread_cond_signal(&queue_not_empty);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+// Returns 0 once the reader is finished and everything has been handed out
+static int queue_pop(Chunk *c) {
+    pthread_mutex_lock(&queue_lock);
+    while (queue_count == 0 && !queue_done) pthread_cond_wait(&queue_not_empty, &queue_lock);
+    int got = queue_count > 0;
+    if (got) {
+        *c = queue[queue_head];
+        queue_head = (queue_head + 1) % QUEUE_SLOTS;
+        queue_count--;
+        pthread_cond_signal(&queue_not_full);
+    }
+    pthread_mutex_unlock(&queue_lock);
+    return got;
+}
+
+// ---------- REPLAYING ONE GAME ----------
+
+#define MAX_CANDIDATES 8
+
+/**
+ * A game being replayed. A short jump like "15x31" can sometimes be done two ways (different
+ * pieces taken), and only the moves after it say which one it was - so we keep every position the
+ * game could be in and drop the ones the next move isn't legal in. Almost always there's just one
+ */
+typedef struct {
+    GameState pos[MAX_CANDIDATES];
+    int count;
+    int plies;
+    int moves_seen;     // anything in this game yet (tags or moves)
+    int bad;            // an illegal move was found, the rest of the game gets skipped
+    uint64_t offset;    // where the game starts in the file
+} Replay;
+
+// Add a position to out[0..n) unless it's already there, returns the new count
+static int add_candidate(GameState *out, int n, const GameState *g) {
+    for (int i = 0; i < n; i++)
+        if (out[i].hash == g->hash) return n;
+    if (n < MAX_CANDIDATES) out[n++] = *g;
+    return n;
+}
+
+/**
+ * Play one move token ("11-15", "15x24", "15x24x31") on 'g'
+ * Every position it can lead to goes into out[] (added to the n already there), returns the new
+ * count - nothing added means it isn't legal under our rules
+ */
+static int replay_move(GameState *g, const char *tok, GameState *out, int n) {
+    int path[16], len = 0, capture = 0;
+    const char *p = tok;
+    while (len < 16) {
+        char *end;
+        long num = strtol(p, &end, 10);
+        if (end == p || number_square((int)num) < 0) return n; // not a move, nothing added
+        path[len++] = number_square((int)num);
+        if (*end == 'x' || *end == 'X' || *end == ':') capture = 1;
+        else if (*end != '-') break;
+        p = end + 1;
+    }
+    if (len < 2) return n;
+
+    uint64_t captures = 0; // only known when every landing square is there
+    for (int i = 1; len > 2 && i < len; i++) captures |= 1ULL << ((path[i - 1] + path[i]) / 2);
+
+    MoveList list;
+    generate_moves(g, &list);
+    for (int i = 0; i < list.count; i++) {
+        Move *m = &list.moves[i];
+        if (m->from != path[0] || m->to != path[len - 1]) continue;
+        if (capture && !m->captures) continue; // "11x15" isn't a step
+        if (len > 2 && m->captures != captures) continue;
+        GameState c = *g;
+        apply_move(&c, m);
+        switch_turn(&c);
+        n = add_candidate(out, n, &c);
+    }
+    return n;
+}
+
+// Play a move on every position the game could be in, returns 0 if it's legal in none of them
+static int replay_step(Replay *r, const char *tok) {
+    GameState next[MAX_CANDIDATES];
+    int n = 0;
+    for (int i = 0; i < r->count; i++) n = replay_move(&r->pos[i], tok, next, n);
+    if (n == 0) return 0;
+    memcpy(r->pos, next, (size_t)n * sizeof(GameState));
+    r->count = n;
+    return 1;
+}
+
+static int is_result(const char *t) {
+    static const char *const results[] = {"1-0", "0-1", "1/2-1/2", "*", "2-0", "0-2", "1-1", "0-0"};
+    for (int i = 0; i < 8; i++)
+        if (strcmp(t, results[i]) == 0) return 1;
+    return 0;
+}
+
+/**
+ * [FEN "B:W21,22,K30:B1-4,K12"] -> position. First letter is who moves (B = the side that moves
+ * first in the books = our red), then each color's squares, K = king, a-b = a range
+ */
+static int read_fen(const char *fen, GameState *g) {
+    GameState p = {0};
+    if (*fen != 'B' && *fen != 'W') return 0;
+    p.turn = *fen == 'B' ? 0 : 1;
+    for (const char *s = strchr(fen, ':'); s; s = strchr(s + 1, ':')) {
+        int red = s[1] == 'B';
+        if (s[1] != 'B' && s[1] != 'W') return 0;
+        const char *q = s + 2;
+        while (*q && *q != ':' && *q != '"') {
+            int king = 0;
+            if (*q == ',' || *q == '.' || *q == ' ') { q++; continue; }
+            if (*q == 'K') { king = 1; q++; }
+            char *end;
+            long a = strtol(q, &end, 10), b = a;
+            if (end == q) return 0;
+            if (*end == '-') { q = end + 1; b = strtol(q, &end, 10); }
+            for (long n = a; n <= b; n++) {
+                int sq = number_square((int)n);
+                if (sq < 0) return 0;
+                uint64_t *board = red ? (king ? &p.red_kings : &p.red) : (king ? &p.black_kings : &p.black);
+                *board |= 1ULL << sq;
+            }
+            q = end;
+        }
+    }
+    p.hash = compute_hash(&p);
+    p.eval = compute_eval(&p);
+    NN_REFRESH(&p);
+    *g = p;
+    return 1;
+}
+
+typedef struct {
+    uint64_t games, moves, bad;
+} Counts;
+
+static void start_game(Replay *r, uint64_t offset) {
+    init_board(&r->pos[0]);
+    r->count = 1;
+    r->plies = r->moves_seen = r->bad = 0;
+    r->offset = offset;
+}
+
+static void end_game(Replay *r, Counts *c) {
+    if (!r->moves_seen) return; // nothing there (e.g. blank lines between games)
+    c->games++;
+    c->moves += (uint64_t)r->plies;
+    c->bad += r->bad != 0;
+    r->moves_seen = 0;
+}
+
+static void report(const Replay *r, const char *tok) {
+    pthread_mutex_lock(&totals_lock);
+    if (errors_shown++ < errors_to_show)
+        fprintf(stderr, "%s: game at byte %llu, ply %d: illegal move \"%s\"\n", current_file,
+                (unsigned long long)r->offset, r->plies + 1, tok);
+    pthread_mutex_unlock(&totals_lock);
+}
+
+/**
+ * Replay every game in a chunk
+ * Goes a line at a time: tag lines, or move text (comments {..} and variations (..) skipped,
+ * they can go over several lines)
+ */
+static void check_chunk(Chunk *ch) {
+    Counts c = {0, 0, 0};
+    Replay r;
+    start_game(&r, ch->offset);
+    int in_moves = 0, comment = 0, variation = 0;
+
+    char *data = ch->data, *end = ch->data + ch->len;
+    for (char *line = data; line < end; ) {
+        char *eol = memchr(line, '\n', (size_t)(end - line));
+        if (!eol) eol = end;
+
+        if (!comment && !variation && *line == '[') { // tag
+            if (in_moves) { end_game(&r, &c); start_game(&r, ch->offset + (uint64_t)(line - data)); in_moves = 0; }
+            if (!r.moves_seen) r.offset = ch->offset + (uint64_t)(line - data);
+            r.moves_seen = 1;
+            if (strncmp(line, "[FEN \"", 6) == 0 && !read_fen(line + 6, &r.pos[0])) {
+                r.bad = 1;
+                report(&r, "(bad FEN)");
+            }
+        } else {
+            for (char *p = line; p < eol; ) {
+                if (comment) { if (*p == '}') comment = 0; p++; continue; }
+                if (*p == '{') { comment = 1; p++; continue; }
+                if (*p == '(') { variation++; p++; continue; }
+                if (*p == ')') { if (variation) variation--; p++; continue; }
+                if (variation || isspace((unsigned char)*p)) { p++; continue; }
+
+                char tok[64];
+                size_t n = 0;
+                while (p < eol && !isspace((unsigned char)*p) && *p != '{' && *p != '(' && n < sizeof(tok) - 1) tok[n++] = *p++;
+                tok[n] = '\0';
+                while (n > 0 && (tok[n - 1] == '!' || tok[n - 1] == '?')) tok[--n] = '\0'; // annotations
+                if (n == 0 || tok[0] == '$') continue; // NAG
+
+                if (is_result(tok)) { // game over, anything after it before a tag is a new game
+                    r.moves_seen = 1;
+                    end_game(&r, &c);
+                    start_game(&r, ch->offset + (uint64_t)(p - data));
+                    in_moves = 0;
+                    continue;
+                }
+                char *dot = strrchr(tok, '.');
+                if (dot) { // "12." / "12..." / "12.11-15"
+                    if (!isdigit((unsigned char)tok[0])) continue;
+                    memmove(tok, dot + 1, strlen(dot + 1) + 1);
+                    if (!tok[0]) continue;
+                }
+
+                if (!r.moves_seen) r.offset = ch->offset + (uint64_t)(p - data);
+                r.moves_seen = 1;
+                in_moves = 1;
+                if (r.bad) continue;
+                if (!replay_step(&r, tok)) { r.bad = 1; report(&r, tok); continue; }
+                r.plies++;
+            }
+        }
+        line = eol + 1;
+    }
+    end_game(&r, &c);
+
+    pthread_mutex_lock(&totals_lock);
+    total_games += c.games;
+    total_moves += c.moves;
+    bad_games += c.bad;
+    pthread_mutex_unlock(&totals_lock);
+}
+
+static void *pdn_worker(void *arg) {
+    (void)arg;
+    Chunk ch;
+    while (queue_pop(&ch)) {
+        check_chunk(&ch);
+        free(ch.data);
+    }
+    return NULL;
+}
+
+// ---------- READING ----------
+
+/**
+ * Where the last game in buf[0..len) starts: a line beginning with '[' whose previous non-blank
+ * line isn't a tag (so it's move text from the game before). 0 if there isn't one
+ */
+static size_t last_boundary(const char *buf, size_t len) {
+    for (size_t i = len; i-- > 1; ) {
+        if (buf[i] != '[' || buf[i - 1] != '\n') continue;
+        size_t j = i - 1; // walk back over blank lines to the previous real line
+        while (j > 0 && isspace((unsigned char)buf[j - 1])) j--;
+        size_t start = j;
+        while (start > 0 && buf[start - 1] != '\n') start--;
+        if (j > 0 && buf[start] != '[') return i;
+    }
+    return 0;
+}
+
+/**
+ * Read one file in chunks and queue them up cut at game boundaries
+ * Returns the bytes read
+ */
+static uint64_t read_file(int fd) {
+    uint64_t offset = 0;
+    char *buf = malloc(CHUNK_SIZE);
+    size_t len = 0;
+    if (!buf) return 0;
+
+    while (1) {
+        ssize_t n = read(fd, buf + len, CHUNK_SIZE - len);
+        if (n < 0) { perror("read"); break; }
+        len += (size_t)n;
+        int eof = n == 0;
+        if (len < CHUNK_SIZE && !eof) continue; // fill the whole chunk first
+
+        size_t cut = eof ? len : last_boundary(buf, len);
+        if (cut == 0) cut = len; // one game bigger than a whole chunk, it gets cut (and probably flagged)
+
+        char *next = malloc(CHUNK_SIZE);
+        if (!next) { fprintf(stderr, "Out of memory.\n"); break; }
+        memcpy(next, buf + cut, len - cut); // carry the start of the next game over
+        Chunk ch = {buf, cut, offset};
+        if (workers_running) queue_push(ch);
+        else { check_chunk(&ch); free(ch.data); }
+        offset += cut;
+        len -= cut;
+        buf = next;
+        if (eof) break;
+    }
+    free(buf);
+    return offset;
+}
+
+int main(int argc, char **argv) {
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-' && argv[arg][1]; arg += 2) {
+        if (strcmp(argv[arg], "-t") == 0) threads = atoi(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-e") == 0) errors_to_show = atoi(argv[arg + 1]);
+    }
+    if (arg >= argc) { printf("Usage: %s [-t threads] [-e errors_to_show] file.pdn...\n", argv[0]); return 1; }
+    if (threads < 1) threads = 1;
+    if (threads > 256) threads = 256;
+
+    GameState g;
+    init_board(&g); // zobrist keys get made here, before the workers need them
+    double start = now_ms();
+    uint64_t bytes = 0;
+
+    for (; arg < argc; arg++) {
+        int fd = strcmp(argv[arg], "-") == 0 ? STDIN_FILENO : open(argv[arg], O_RDONLY);
+        if (fd < 0) { printf("Can't read %s\n", argv[arg]); return 1; }
+        current_file = argv[arg];
+        queue_done = 0;
+
+        pthread_t ids[256];
+        int started = 0;
+        for (int t = 0; t < threads; t++, started++)
+            if (pthread_create(&ids[t], NULL, pdn_worker, NULL) != 0) break;
+        workers_running = started;
+        bytes += read_file(fd);
+        if (fd != STDIN_FILENO) close(fd);
+
+        pthread_mutex_lock(&queue_lock);
+        queue_done = 1;
+        pthread_cond_broadcast(&queue_not_empty);
+        pthread_mutex_unlock(&queue_lock);
+        for (int t = 0; t < started; t++) pthread_join(ids[t], NULL);
+    }
+
+    double secs = (now_ms() - start) / 1000.0;
+    if (errors_shown > errors_to_show) fprintf(stderr, "... %d more errors not shown\n", errors_shown - errors_to_show);
+    printf("%llu games, %llu moves, %llu with illegal moves\n", (unsigned long long)total_games,
+           (unsigned long long)total_moves, (unsigned long long)bad_games);
+    printf("%.3f s: %.0f games/s, %.1f MB/s\n", secs, secs > 0 ? total_games / secs : 0.0,
+           secs > 0 ? bytes / secs / 1e6 : 0.0);
+    return bad_games ? 2 : 0;
+}
@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#define CHECKERS_NO_MAIN // we only want the rules out of checkers.c, not its game loop
+#include "checkers.c"
+
+/**
+ * Perft - walk every move from a position down to a fixed depth and count the leaves
+ *
+ * If the count matches the known numbers, move generation, move_piece() and promote() are right.
+ * It also doubles as the speed benchmark since it does nothing but generate and play moves
+ *
+ * Usage:
+ *   ./perft <depth>                      counts for depth 1..depth from init_board(), checked against known numbers
+ *   ./perft -d <depth>                   divide: leaf count under each root move
+ *   ./perft -b <depth>                   batch benchmark: every position 'depth' moves in goes through
+ *                                        batch_movegen() with each SIMD backend, checked against scalar
+ *   ./perft [-d] <depth> <turn> <red> <black> <red_kings> <black_kings>
+ *                                        same thing from a given position, turn is r or b and boards are
+ *                                        hex (0x prefix optional)
+ */
+
+// Known leaf counts for the starting position (standard checkers, captures forced), index = depth
+static const uint64_t known_perft[] = {
+    1ULL, 7ULL, 49ULL, 302ULL, 1469ULL, 7361ULL, 36768ULL, 179740ULL, 845931ULL,
+    3963680ULL, 18391564ULL, 85242128ULL, 388623673ULL
+};
+#define KNOWN_DEPTH (int)(sizeof(known_perft) / sizeof(known_perft[0]) - 1)
+
+/**
+ * Count leaves 'depth' moves down
+ * Depth 1 just returns the move count (bulk counting) since playing the last move changes nothing
+ */
+uint64_t perft(GameState *g, int depth) {
+    MoveList list;
+    generate_moves(g, &list);
+    if (depth <= 1) return depth == 1 ? (uint64_t)list.count : 1;
+
+    uint64_t leaves = 0;
+    Undo u;
+    for (int i = 0; i < list.count; i++) {
+        make_move(g, list.moves[i], &u);
+        leaves += perft(g, depth - 1);
+        unmake_move(g, &u);
+    }
+    return leaves;
+}
+
+// Wall clock in seconds, for nodes/second
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Divide - perft for each root move on its own line so a wrong total can be tracked down
+ * to the move that is off
+ */
+uint64_t divide(GameState *g, int depth) {
+    MoveList list;
+    generate_moves(g, &list);
+
+    uint64_t total = 0;
+    for (int i = 0; i < list.count; i++) {
+        Move *m = &list.moves[i];
+        Undo u;
+        make_move(g, *m, &u);
+        uint64_t leaves = depth > 1 ? perft(g, depth - 1) : 1;
+        unmake_move(g, &u);
+        printf("%d %d -> %d %d%s: %llu\n", m->from / 8, m->from % 8, m->to / 8, m->to % 8,
+               m->captures ? " (x)" : "", (unsigned long long)leaves);
+        total += leaves;
+    }
+    printf("Moves: %d\n", list.count);
+    return total;
+}
+
+// ---------- BATCH BENCHMARK ----------
+
+// Positions for the batch benchmark, one array per board like batch_movegen() wants them
+typedef struct {
+    uint64_t *red, *black, *red_kings, *black_kings;
+    uint8_t *turn;
+    size_t count, capacity;
+} PositionSet;
+
+// Walk the tree like perft but save every position at the bottom instead of counting it
+static void collect_positions(GameState *g, int depth, PositionSet *set) {
+    if (depth == 0) {
+        if (set->count == set->capacity) return; // full, the benchmark has plenty already
+        set->red[set->count] = g->red;
+        set->black[set->count] = g->black;
+        set->red_kings[set->count] = g->red_kings;
+        set->black_kings[set->count] = g->black_kings;
+        set->turn[set->count] = (uint8_t)g->turn;
+        set->count++;
+        return;
+    }
+    MoveList list;
+    generate_moves(g, &list);
+    Undo u;
+    for (int i = 0; i < list.count; i++) {
+        make_move(g, list.moves[i], &u);
+        collect_positions(g, depth - 1, set);
+        unmake_move(g, &u);
+    }
+}
+
+/**
+ * Run every position 'depth' moves in through batch_movegen() with each backend the CPU has,
+ * check the results match the scalar version exactly and print positions/second
+ */
+int batch_benchmark(GameState *g, int depth) {
+    PositionSet set = {0};
+    set.capacity = 1 << 22; // 4M positions max, ~140 MB
+    set.red = malloc(set.capacity * sizeof(uint64_t));
+    set.black = malloc(set.capacity * sizeof(uint64_t));
+    set.red_kings = malloc(set.capacity * sizeof(uint64_t));
+    set.black_kings = malloc(set.capacity * sizeof(uint64_t));
+    set.turn = malloc(set.capacity);
+    uint64_t *movers = malloc(set.capacity * sizeof(uint64_t)), *ref_movers = malloc(set.capacity * sizeof(uint64_t));
+    uint64_t *jumpers = malloc(set.capacity * sizeof(uint64_t)), *ref_jumpers = malloc(set.capacity * sizeof(uint64_t));
+    uint16_t *counts = malloc(set.capacity * sizeof(uint16_t)), *ref_counts = malloc(set.capacity * sizeof(uint16_t));
+    if (!set.red || !set.black || !set.red_kings || !set.black_kings || !set.turn || !movers ||
+        !ref_movers || !jumpers || !ref_jumpers || !counts || !ref_counts) {
+        printf("Not enough memory for the batch benchmark.\n");
+        return 1;
+    }
+
+    collect_positions(g, depth, &set);
+    printf("%zu positions at depth %d\n", set.count, depth);
+
+    set_batch_backend(BATCH_SCALAR);
+    batch_movegen(set.red, set.black, set.red_kings, set.black_kings, set.turn, set.count,
+                  ref_movers, ref_jumpers, ref_counts);
+
+    int errors = 0;
+    int rounds = (int)(20000000 / (set.count + 1)) + 1; // about 20M positions per backend
+    for (int b = BATCH_SCALAR; b <= BATCH_AVX512; b++) {
+        if (set_batch_backend(b) != b) continue; // CPU doesn't have it
+
+        double start = now_seconds();
+        for (int r = 0; r < rounds; r++)
+            batch_movegen(set.red, set.black, set.red_kings, set.black_kings, set.turn, set.count,
+                          movers, jumpers, counts);
+        double secs = now_seconds() - start;
+
+        size_t bad = 0;
+        for (size_t i = 0; i < set.count; i++)
+            if (movers[i] != ref_movers[i] || jumpers[i] != ref_jumpers[i] || counts[i] != ref_counts[i]) bad++;
+        errors += bad != 0;
+        printf("%-7s %14.0f positions/s  %s\n", batch_backend_names[b],
+               secs > 0 ? (double)set.count * rounds / secs : 0.0, bad ? "MISMATCH" : "OK");
+    }
+
+    free(set.red); free(set.black); free(set.red_kings); free(set.black_kings); free(set.turn);
+    free(movers); free(ref_movers); free(jumpers); free(ref_jumpers); free(counts); free(ref_counts);
+    return errors ? 1 : 0;
+}
+
+/**
+ * Read a position from the command line: turn then the four boards in hex
+ * Returns 0 if anything doesn't parse, a piece is on a light square, or two boards share a square
+ * (men and kings are separate boards, same checks as the protocol's position command)
+ */
+int parse_position(GameState *g, char **argv) {
+    if (strcmp(argv[0], "r") != 0 && strcmp(argv[0], "b") != 0) return 0;
+    init_board(g); // start from a clean state, then overwrite the boards
+    g->turn = argv[0][0] == 'r' ? 0 : 1;
+
+    uint64_t *boards[4] = {&g->red, &g->black, &g->red_kings, &g->black_kings};
+    uint64_t seen = 0;
+    for (int i = 0; i < 4; i++) {
+        char *end;
+        *boards[i] = strtoull(argv[i + 1], &end, 16);
+        if (*end != '\0' || (*boards[i] & seen) || (*boards[i] & ~DARK_SQUARES)) return 0;
+        seen |= *boards[i];
+    }
+    g->hash = compute_hash(g);
+    g->eval = compute_eval(g);
+    NN_REFRESH(g);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    int do_divide = 0, do_batch = 0;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "-d") == 0) { do_divide = 1; arg++; }
+    else if (arg < argc && strcmp(argv[arg], "-b") == 0) { do_batch = 1; arg++; }
+
+    if (arg >= argc) {
+        printf("Usage: %s [-d|-b] <depth> [r|b red black red_kings black_kings]\n", argv[0]);
+        return 1;
+    }
+    int depth = atoi(argv[arg++]);
+    if (depth < 1) { printf("Depth must be at least 1.\n"); return 1; } // Error catch
+
+    GameState g;
+    init_board(&g);
+    int from_start = 1; // only the starting position has known numbers to check against
+    if (arg < argc) {
+        if (argc - arg != 5 || !parse_position(&g, &argv[arg])) {
+            printf("Position must be: r|b red black red_kings black_kings (hex boards, dark squares only, no square on two boards)\n");
+            return 1;
+        }
+        from_start = 0;
+    }
+    print_game(&g);
+
+    if (do_batch) return batch_benchmark(&g, depth);
+
+    if (do_divide) {
+        double start = now_seconds();
+        uint64_t total = divide(&g, depth);
+        double secs = now_seconds() - start;
+        printf("Total: %llu (%.3f s, %.0f nodes/s)\n", (unsigned long long)total, secs,
+               secs > 0 ? total / secs : 0.0);
+        return 0;
+    }
+
+    int mismatches = 0;
+    for (int d = 1; d <= depth; d++) {
+        double start = now_seconds();
+        uint64_t leaves = perft(&g, d);
+        double secs = now_seconds() - start;
+        printf("perft %2d: %12llu  %8.3f s  %12.0f nodes/s", d, (unsigned long long)leaves, secs,
+               secs > 0 ? leaves / secs : 0.0);
+
+        if (from_start && d <= KNOWN_DEPTH) {
+            int ok = leaves == known_perft[d];
+            if (!ok) mismatches++;
+            printf("  %s", ok ? "OK" : "MISMATCH");
+            if (!ok) printf(" (expected %llu)", (unsigned long long)known_perft[d]);
+        }
+        printf("\n");
+    }
+    return mismatches ? 1 : 0; // nonzero exit so scripts can catch a regression
+}
@@ -0,0 +1,209 @@
+/**
+ * Engine protocol - a plain text, one command per line mode for other programs to drive the engine
+ * over a pipe (./checkers -p), no prompts and no board unless someone asks for it
+ *
+ * Included from checkers.c after search.c and book.c
+ *
+ * Every answer gets built up in one buffer and written with a single write() when the command is
+ * done, so a controller running thousands of engines pays one syscall per command instead of one
+ * per printf. Moves use standard notation (see parse_move()), positions the same hex boards as perft
+ *
+ * Commands:
+ *   isready                                   -> readyok
+ *   newgame                                   start position + forget the transposition table
+ *   position start [moves m1 m2 ...]          set the position (from the start)
+ *   position r|b red black rkings bkings [moves ...]   (hex boards, same as perft)
+ *   move m1 m2 ...                            play moves on the current position
+ *   legal                                     -> legal m1 m2 ...   (just "legal" if there are none)
+ *   go [depth n] [ms n] [threads n]           -> bestmove m score s depth d nodes n time t pv m1 m2 ...
+ *                                                (bestmove none if there's no move, "book" if it came from the book)
+ *                                                no limit above 0 at all = ms 1000
+ *   book on|off                               use the opening book in go (on by default if one's loaded)
+ *   show                                      -> the position as hex boards
+ *   print                                     -> the board drawn like print_game(), then "end"
+ *   stats [reset]                             -> the instrumentation counters as one line of JSON (see stats.c),
+ *                                                reset zeroes them after printing
+ *   quit
+ * Anything it can't do gets "error <why>"
+ */
+#include <stdarg.h>
+
+#define PROTOCOL_OUT_SIZE 8192
+
+typedef struct {
+    char buf[PROTOCOL_OUT_SIZE];
+    size_t len;
+} OutBuffer;
+
+// printf into the buffer (anything past the end gets dropped, no answer is anywhere near that big)
+static void out_printf(OutBuffer *o, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->len, sizeof(o->buf) - o->len, fmt, ap);
+    va_end(ap);
+    if (n > 0) o->len = o->len + (size_t)n < sizeof(o->buf) ? o->len + (size_t)n : sizeof(o->buf) - 1;
+}
+
+// The one write() per command
+static void out_flush(OutBuffer *o) {
+    size_t done = 0;
+    while (done < o->len) {
+        ssize_t n = write(STDOUT_FILENO, o->buf + done, o->len - done);
+        if (n <= 0) break; // Error catch - controller went away, nothing else we can do
+        done += (size_t)n;
+    }
+    o->len = 0;
+}
+
+// Same drawing as print_game(), one row at a time straight off the boards
+static void out_board(OutBuffer *o, GameState *g) {
+    out_printf(o, "    0 1 2 3 4 5 6 7\n");
+    for (int row = 7; row >= 0; row--) {
+        char line[32];
+        int n = sprintf(line, "%d | ", row);
+        for (int col = 0; col < 8; col++) {
+            uint64_t bit = 1ULL << (row * 8 + col);
+            line[n++] = g->black_kings & bit ? 'B' : g->red_kings & bit ? 'R' : g->black & bit ? 'b' : g->red & bit ? 'r' : '.';
+            line[n++] = ' ';
+        }
+        line[n] = '\0';
+        out_printf(o, "%s\n", line);
+    }
+    out_printf(o, "Turn: %s\n", g->turn == 0 ? "Red" : "Black");
+}
+
+// Play the moves tok[0..n-1] in order, stops and returns 0 (saying which) at the first one that isn't legal
+static int play_moves(OutBuffer *o, GameState *g, char **tok, int n) {
+    for (int i = 0; i < n; i++) {
+        Move m;
+        if (!parse_move(g, tok[i], &m)) { out_printf(o, "error illegal move %s\n", tok[i]); return 0; }
+        apply_move(g, &m);
+        switch_turn(g);
+    }
+    return 1;
+}
+
+/**
+ * tok = "r|b red black rkings bkings" -> 'g'
+ * Pieces have to be on dark squares and can't share a square
+ */
+static int read_position(GameState *g, char **tok) {
+    if (strcmp(tok[0], "r") != 0 && strcmp(tok[0], "b") != 0) return 0;
+    GameState p;
+    p.turn = tok[0][0] == 'r' ? 0 : 1;
+    uint64_t *boards[4] = {&p.red, &p.black, &p.red_kings, &p.black_kings};
+    uint64_t seen = 0;
+    for (int i = 0; i < 4; i++) {
+        char *end;
+        *boards[i] = strtoull(tok[i + 1], &end, 16);
+        if (*end != '\0' || (*boards[i] & seen) || (*boards[i] & ~DARK_SQUARES)) return 0;
+        seen |= *boards[i];
+    }
+    p.hash = compute_hash(&p);
+    p.eval = compute_eval(&p);
+    NN_REFRESH(&p);
+    *g = p;
+    return 1;
+}
+
+// go [depth n] [ms n] [threads n] - book move if there is one, otherwise search
+static void protocol_go(OutBuffer *o, GameState *g, char **tok, int n, int use_book) {
+    SearchLimits limits = {0, 1000, 1}; // nothing given = one second
+    int depth_given = 0, ms_given = 0;
+    for (int i = 0; i + 1 < n; i += 2) {
+        int v = atoi(tok[i + 1]);
+        if (strcmp(tok[i], "depth") == 0) { limits.max_depth = v; depth_given = 1; }
+        else if (strcmp(tok[i], "ms") == 0) { limits.time_ms = v; ms_given = 1; }
+        else if (strcmp(tok[i], "threads") == 0) limits.threads = v;
+    }
+    if (depth_given && !ms_given) limits.time_ms = 0; // just the depth then
+    if (limits.max_depth <= 0 && limits.time_ms <= 0) limits.time_ms = 1000; // Error catch - has to stop somehow
+
+    char text[MOVE_TEXT_SIZE];
+    Move m;
+    if (use_book && book_probe(g, &m)) {
+        move_to_text(&m, text);
+        out_printf(o, "bestmove %s book\n", text);
+        return;
+    }
+    SearchResult r = search_position(g, limits);
+    if (!r.has_move) { out_printf(o, "bestmove none\n"); return; }
+    move_to_text(&r.best, text);
+    out_printf(o, "bestmove %s score %d depth %d nodes %llu time %.3f pv", text, r.score, r.depth,
+               (unsigned long long)r.nodes, r.seconds);
+    for (int i = 0; i < r.pv_length; i++) {
+        move_to_text(&r.pv[i], text);
+        out_printf(o, " %s", text);
+    }
+    out_printf(o, "\n");
+}
+
+#define PROTOCOL_MAX_TOKENS 1024
+
+/**
+ * The protocol loop, runs until quit or the input ends
+ * Returns 0 so main() can just return it
+ */
+int protocol_loop(void) {
+    static OutBuffer out; // one answer at a time, off the stack
+    static char *tok[PROTOCOL_MAX_TOKENS];
+    GameState g;
+    init_board(&g);
+    int use_book = book.entries != NULL;
+    char *line = NULL;
+    size_t cap = 0;
+
+    while (getline(&line, &cap, stdin) > 0) {
+        int n = 0;
+        for (char *t = strtok(line, " \t\r\n"); t && n < PROTOCOL_MAX_TOKENS; t = strtok(NULL, " \t\r\n")) tok[n++] = t;
+        if (n == 0) continue; // blank line
+        const char *cmd = tok[0];
+
+        if (strcmp(cmd, "quit") == 0) break;
+        else if (strcmp(cmd, "isready") == 0) out_printf(&out, "readyok\n");
+        else if (strcmp(cmd, "newgame") == 0) { init_board(&g); tt_clear(&default_engine.tt); }
+        else if (strcmp(cmd, "position") == 0) {
+            GameState p;
+            int next; // where "moves" would be
+            if (n >= 2 && strcmp(tok[1], "start") == 0) { init_board(&p); next = 2; }
+            else if (n >= 6 && read_position(&p, &tok[1])) next = 6;
+            else { out_printf(&out, "error bad position\n"); out_flush(&out); continue; }
+            if (next < n && strcmp(tok[next], "moves") != 0) { out_printf(&out, "error expected moves\n"); out_flush(&out); continue; }
+            if (next < n && !play_moves(&out, &p, &tok[next + 1], n - next - 1)) { out_flush(&out); continue; } // keep the old position
+            g = p;
+        }
+        else if (strcmp(cmd, "move") == 0) {
+            GameState p = g;
+            if (play_moves(&out, &p, &tok[1], n - 1)) g = p; // all or nothing
+        }
+        else if (strcmp(cmd, "legal") == 0) {
+            MoveList list;
+            generate_moves(&g, &list);
+            out_printf(&out, "legal");
+            for (int i = 0; i < list.count; i++) {
+                char text[MOVE_TEXT_SIZE];
+                move_to_text(&list.moves[i], text);
+                out_printf(&out, " %s", text);
+            }
+            out_printf(&out, "\n");
+        }
+        else if (strcmp(cmd, "go") == 0) protocol_go(&out, &g, &tok[1], n - 1, use_book);
+        else if (strcmp(cmd, "book") == 0 && n == 2) use_book = strcmp(tok[1], "on") == 0 && book.entries;
+        else if (strcmp(cmd, "show") == 0)
+            out_printf(&out, "position %c %016llx %016llx %016llx %016llx\n", g.turn ? 'b' : 'r',
+                       (unsigned long long)g.red, (unsigned long long)g.black,
+                       (unsigned long long)g.red_kings, (unsigned long long)g.black_kings);
+        else if (strcmp(cmd, "print") == 0) { out_board(&out, &g); out_printf(&out, "end\n"); }
+        else if (strcmp(cmd, "stats") == 0) {
+            char json[2048];
+            stats_json(json, sizeof(json));
+            out_printf(&out, "%s\n", json);
+            if (n == 2 && strcmp(tok[1], "reset") == 0) stats_reset();
+        }
+        else out_printf(&out, "error unknown command %s\n", cmd);
+        out_flush(&out);
+    }
+    free(line);
+    out_flush(&out);
+    return 0;
+}
@@ -0,0 +1,175 @@
+/**
+ * Packed position records - a fixed 16 byte form of a position for storing lots of them in files
+ *
+ * Included from checkers.c after tablebase.c (uses its mmap headers)
+ *
+ * GameState is 48 bytes with the padding and the hash, and 3/4 of every board is squares pieces can
+ * never be on. A record only keeps the 32 dark squares (board32.c's layout):
+ *   occupied   which dark squares have a piece
+ *   black      which of those are black (the rest are red)
+ *   kings      which of those are kings (the rest are men)
+ * plus the turn, an optional score (e.g. what the search said, for training data) and an optional
+ * final result of the game the position came from
+ *
+ * File = RecordHeader then records back to back. Reading mmaps the file and hands out a pointer
+ * straight into the mapping, so going through a file is just walking an array. Writing goes through
+ * a big stdio buffer so it's a few large writes instead of one per record
+ */
+
+#define RECORD_BLACK_TO_MOVE 1
+#define RECORD_HAS_SCORE 2
+#define RECORD_HAS_RESULT 4
+#define RECORD_RED_WON 8        // with RECORD_HAS_RESULT, neither won = draw
+#define RECORD_BLACK_WON 16
+#define RECORD_FLAGS (RECORD_BLACK_TO_MOVE | RECORD_HAS_SCORE | RECORD_HAS_RESULT | RECORD_RED_WON | RECORD_BLACK_WON)
+#define RECORD_VERSION 1
+
+typedef struct {
+    uint32_t occupied;
+    uint32_t black;
+    uint32_t kings;
+    int16_t score;      // only means something with RECORD_HAS_SCORE
+    uint8_t flags;      // RECORD_BLACK_TO_MOVE | RECORD_HAS_SCORE | RECORD_HAS_RESULT ...
+    uint8_t reserved;   // always 0
+} PackedPosition;
+
+_Static_assert(sizeof(PackedPosition) == 16, "records are read straight out of files, size can't change");
+
+typedef struct {
+    char magic[8];          // "BBCHKPOS"
+    uint32_t version;       // RECORD_VERSION
+    uint32_t record_size;   // sizeof(PackedPosition), so a reader never walks a file with the wrong stride
+} RecordHeader;
+
+// A mmap'd record file, records[0..count-1] point into the mapping
+typedef struct {
+    const PackedPosition *records;
+    uint64_t count;
+    void *map;
+    size_t map_size;
+} RecordFile;
+
+typedef struct {
+    FILE *f;
+    char *buffer;
+    uint64_t count;     // records written so far
+} RecordWriter;
+
+#define RECORD_WRITE_BUFFER (1 << 20)
+
+// Squeeze a position down to a record. No score = pass has_score 0
+PackedPosition pack_position(GameState *g, int has_score, int score) {
+    PackedPosition p;
+    p.occupied = to_dark32(g->red | g->black | g->red_kings | g->black_kings);
+    p.black = to_dark32(g->black | g->black_kings);
+    p.kings = to_dark32(g->red_kings | g->black_kings);
+    p.score = has_score ? (int16_t)score : 0;
+    p.flags = (uint8_t)((g->turn ? RECORD_BLACK_TO_MOVE : 0) | (has_score ? RECORD_HAS_SCORE : 0));
+    p.reserved = 0;
+    return p;
+}
+
+// Record back to a full position (the hash and eval get recomputed, records don't store it)
+void unpack_position(const PackedPosition *p, GameState *g) {
+    uint64_t all = from_dark32(p->occupied);
+    uint64_t black = from_dark32(p->black);
+    uint64_t kings = from_dark32(p->kings);
+    g->red = all & ~black & ~kings;
+    g->black = black & ~kings;
+    g->red_kings = all & ~black & kings;
+    g->black_kings = black & kings;
+    g->turn = p->flags & RECORD_BLACK_TO_MOVE ? 1 : 0;
+    g->hash = compute_hash(g);
+    g->eval = compute_eval(g);
+    NN_REFRESH(g);
+}
+
+// How the game went in the end: 1 = red won, 0 = draw, -1 = black won
+void record_set_result(PackedPosition *p, int result) {
+    p->flags = (uint8_t)((p->flags & ~(RECORD_RED_WON | RECORD_BLACK_WON)) | RECORD_HAS_RESULT |
+                         (result > 0 ? RECORD_RED_WON : 0) | (result < 0 ? RECORD_BLACK_WON : 0));
+}
+
+// Same numbers back (0 for records without a result, check RECORD_HAS_RESULT to tell them from draws)
+int record_result(const PackedPosition *p) {
+    return p->flags & RECORD_RED_WON ? 1 : p->flags & RECORD_BLACK_WON ? -1 : 0;
+}
+
+/**
+ * Could this record be a real position? (for checking files from somewhere else)
+ * Colors and kings have to be on occupied squares, men can't be on their crowning row,
+ * and nobody has more than 12 pieces
+ */
+int record_valid(const PackedPosition *p) {
+    if ((p->black | p->kings) & ~p->occupied) return 0;
+    if (p->flags & ~RECORD_FLAGS || p->reserved) return 0;
+    if ((p->flags & (RECORD_RED_WON | RECORD_BLACK_WON)) && !(p->flags & RECORD_HAS_RESULT)) return 0;
+    if ((p->flags & RECORD_RED_WON) && (p->flags & RECORD_BLACK_WON)) return 0;
+    uint32_t red = p->occupied & ~p->black, men = p->occupied & ~p->kings;
+    if (popcount(red) > 12 || popcount(p->black) > 12) return 0;
+    // dark squares 28-31 are row 7 (red crowns there), 0-3 are row 0 (black crowns there)
+    if (men & red & 0xF0000000u || men & p->black & 0x0000000Fu) return 0;
+    return 1;
+}
+
+/**
+ * mmap a record file, nothing gets copied - rf->records points right into the file
+ * Returns 1 on success, 0 if the file isn't there or isn't a record file
+ */
+int record_file_open(const char *path, RecordFile *rf) {
+    memset(rf, 0, sizeof(*rf));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(RecordHeader)) { close(fd); return 0; }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+
+    const RecordHeader *h = map;
+    if (memcmp(h->magic, "BBCHKPOS", 8) != 0 || h->version != RECORD_VERSION ||
+        h->record_size != sizeof(PackedPosition)) {
+        munmap(map, (size_t)st.st_size); // Error catch - not ours, or a different layout
+        return 0;
+    }
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL); // usually read front to back, read ahead a lot
+
+    rf->records = (const PackedPosition *)(h + 1);
+    rf->count = ((size_t)st.st_size - sizeof(RecordHeader)) / sizeof(PackedPosition); // a torn last record gets ignored
+    rf->map = map;
+    rf->map_size = (size_t)st.st_size;
+    return 1;
+}
+
+void record_file_close(RecordFile *rf) {
+    if (rf->map) munmap(rf->map, rf->map_size);
+    memset(rf, 0, sizeof(*rf));
+}
+
+// Start a new record file (replaces whatever is there). Returns 0 if it can't be created
+int record_writer_open(RecordWriter *w, const char *path) {
+    memset(w, 0, sizeof(*w));
+    w->f = fopen(path, "wb");
+    if (!w->f) return 0;
+    w->buffer = malloc(RECORD_WRITE_BUFFER);
+    if (w->buffer) setvbuf(w->f, w->buffer, _IOFBF, RECORD_WRITE_BUFFER); // no buffer = stdio's default, still works
+    RecordHeader h = {"BBCHKPOS", RECORD_VERSION, sizeof(PackedPosition)};
+    return fwrite(&h, sizeof(h), 1, w->f) == 1;
+}
+
+int record_write(RecordWriter *w, const PackedPosition *p) {
+    if (fwrite(p, sizeof(*p), 1, w->f) != 1) return 0;
+    w->count++;
+    return 1;
+}
+
+// Flush and close, returns 0 if anything failed to make it to the disk
+int record_writer_close(RecordWriter *w) {
+    int ok = w->f && !ferror(w->f);
+    if (w->f && fclose(w->f) != 0) ok = 0;
+    free(w->buffer); // only after fclose, stdio was still using it
+    w->f = NULL;
+    w->buffer = NULL;
+    return ok;
+}
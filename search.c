@@ -0,0 +1,691 @@
+/**
+ * Computer player - iterative deepening alpha-beta with a transposition table
+ *
+ * Included from checkers.c after movegen.c, so GameState, generate_moves() and apply_move()
+ * are already there
+ *
+ * The pieces:
+ *   - negamax alpha-beta: every score is from the side to move's point of view, so a child's
+ *     score just gets flipped with a minus sign instead of having separate min/max code
+ *   - iterative deepening: search depth 1, then 2, then 3... until the depth or time limit hits.
+ *     Sounds wasteful but the earlier depths fill the table and killers, so the later ones go faster
+ *   - transposition table: remembers positions we already searched (different move orders reach
+ *     the same position all the time in checkers). Buckets are exactly one 64 byte cache line
+ *   - move ordering: table move first, then captures, then killer moves, then history scores
+ *   - Lazy SMP: with more than one thread they all search at once and share the table (lock free),
+ *     see search_position()
+ *   - pondering: while the opponent thinks, a background search on the reply we expect from them,
+ *     see ponder_start()
+ */
+#include <time.h>
+#include <pthread.h>
+
+#define MAX_PLY 64          // deepest the search ever goes (depth + captures at the end)
+#define INF_SCORE 32000     // bigger than any real score
+#define WIN_SCORE 30000     // side to move has no moves left and lost, minus the ply so quicker wins score higher
+#define WIN_RANGE 512       // anything within this of WIN_SCORE is a known win (search or tablebase), not an evaluation
+#define TT_DEFAULT_MB 16    // table size if nobody called tt_init()
+
+// What the caller wants: stop after max_depth, or after time_ms milliseconds, whichever comes first
+typedef struct {
+    int max_depth;  // 0 = only the time limit counts
+    int time_ms;    // 0 = only the depth limit counts
+    int threads;    // search threads sharing the table, 0 or 1 = just the caller's thread
+} SearchLimits;
+
+typedef struct {
+    Move best;          // move to play (only valid if has_move)
+    int has_move;       // 0 if the side to move has no moves at all
+    int score;          // from the side to move's point of view
+    int depth;          // last depth that finished completely
+    uint64_t nodes;     // positions visited
+    double seconds;     // time spent
+    int pv_length;
+    Move pv[MAX_PLY];   // expected line of play, pv[0] = best (empty if not even depth 1 finished)
+} SearchResult;
+
+// ---------- TRANSPOSITION TABLE ----------
+
+enum { TT_EXACT = 1, TT_LOWER = 2, TT_UPPER = 3 }; // score is exact, at least (beta cut), at most (fail low)
+
+/**
+ * 16 bytes per entry, 4 entries per bucket = one 64 byte cache line per probe
+ *
+ * Every search thread reads and writes the table at the same time with no locks, so two threads
+ * can write the same entry at once and leave half of one and half of the other. Instead of the
+ * key the entry keeps key ^ data: a torn entry doesn't XOR back to the right key and just looks
+ * like a miss. Both halves are relaxed atomic loads/stores, which are plain movs on x86
+ */
+typedef struct {
+    uint64_t check;     // key ^ data
+    uint64_t data;      // score, depth, flag, best move and age packed by tt_pack(), 0 = empty slot
+} TTEntry;
+
+typedef struct {
+    _Alignas(64) TTEntry entries[4];
+} TTBucket;
+
+// An entry unpacked by tt_probe()
+typedef struct {
+    int score;
+    int depth;
+    int flag;           // TT_EXACT / TT_LOWER / TT_UPPER
+    int from, to;       // best move found here
+} TTData;
+
+typedef struct {
+    TTBucket *buckets;
+    uint64_t mask;      // bucket count - 1 (bucket count is a power of two)
+    uint8_t age;        // which search wrote an entry, old entries get replaced first
+} TTable;
+
+/**
+ * An engine = one table plus the per-thread search state, everything a search touches
+ * The game uses default_engine through search_position(). Tools that run several searches at once
+ * (the arena plays many games in parallel) give each one its own Engine, they never share anything
+ */
+enum { PONDER_OFF = 0, PONDER_ON, PONDER_HIT, PONDER_MISS }; // Engine.ponder
+
+typedef struct Engine {
+    TTable tt;
+    int stop;                   // set by the main search thread when time's up or it's done, every thread polls it
+    int ponder;                 // PONDER_ON = no clock yet, HIT = clock on, MISS = give up (see ponder_start())
+    struct SearchContext *ctx;  // one per search thread, grown as needed
+    int ctx_count;
+} Engine;
+
+static Engine default_engine;
+
+/**
+ * Allocate a table, rounded down to a power of two number of buckets
+ * Returns 0 if the memory isn't there
+ */
+int tt_alloc(TTable *t, int megabytes) {
+    uint64_t buckets = 1;
+    while (buckets * 2 * sizeof(TTBucket) <= (uint64_t)megabytes * 1024 * 1024) buckets *= 2;
+
+    free(t->buckets);
+    t->buckets = aligned_alloc(64, buckets * sizeof(TTBucket));
+    if (!t->buckets) { t->mask = 0; return 0; }
+    t->mask = buckets - 1;
+    memset(t->buckets, 0, buckets * sizeof(TTBucket));
+    return 1;
+}
+
+// Forget everything in the table (new game)
+void tt_clear(TTable *t) {
+    if (t->buckets) memset(t->buckets, 0, (t->mask + 1) * sizeof(TTBucket));
+}
+
+// Size (or resize) the table search_position() uses
+int tt_init(int megabytes) {
+    return tt_alloc(&default_engine.tt, megabytes);
+}
+
+// Wins get stored relative to the node instead of the root, otherwise they'd be wrong when reached at another ply
+static int score_to_tt(int score, int ply) {
+    if (score > WIN_SCORE - WIN_RANGE) return score + ply;
+    if (score < -WIN_SCORE + WIN_RANGE) return score - ply;
+    return score;
+}
+
+static int score_from_tt(int score, int ply) {
+    if (score > WIN_SCORE - WIN_RANGE) return score - ply;
+    if (score < -WIN_SCORE + WIN_RANGE) return score + ply;
+    return score;
+}
+
+// data bits: score 0-15, depth 16-23, flag 24-31, from 32-39, to 40-47, age 48-55
+static inline uint64_t tt_pack(int score, int depth, int flag, const Move *best, uint8_t age) {
+    return (uint64_t)(uint16_t)score | (uint64_t)(uint8_t)depth << 16 | (uint64_t)flag << 24
+         | (uint64_t)(best ? best->from : 0) << 32 | (uint64_t)(best ? best->to : 0) << 40
+         | (uint64_t)age << 48;
+}
+
+#define TT_DEPTH(data) ((int)(((data) >> 16) & 0xFF))
+#define TT_AGE(data)   ((uint8_t)((data) >> 48))
+
+static inline uint64_t tt_load(const uint64_t *p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+static inline void tt_write(uint64_t *p, uint64_t v) { __atomic_store_n(p, v, __ATOMIC_RELAXED); }
+
+// Returns 1 and fills 'out' if the position is in the table
+static int tt_probe(const TTable *t, uint64_t key, TTData *out) {
+    STAT_INC(TT_PROBES);
+    STAT_TIMER_START(TT_PROBE);
+    TTBucket *b = &t->buckets[key & t->mask];
+    int found = 0;
+    for (int i = 0; i < 4 && !found; i++) {
+        uint64_t data = tt_load(&b->entries[i].data);
+        if (!data || (tt_load(&b->entries[i].check) ^ data) != key) continue;
+        out->score = (int16_t)(data & 0xFFFF);
+        out->depth = TT_DEPTH(data);
+        out->flag = (int)((data >> 24) & 0xFF);
+        out->from = (int)((data >> 32) & 0xFF);
+        out->to = (int)((data >> 40) & 0xFF);
+        found = 1;
+    }
+    STAT_TIMER_STOP(TT_PROBE);
+    if (found) STAT_INC(TT_HITS);
+    return found;
+}
+
+/**
+ * Store a result, replacing (in order): the same position, an empty slot, or the slot that's
+ * from an older search / searched the shallowest
+ */
+static void tt_store(TTable *t, uint64_t key, int depth, int score, int flag, const Move *best) {
+    STAT_INC(TT_STORES);
+    TTBucket *b = &t->buckets[key & t->mask];
+    TTEntry *slot = &b->entries[0];
+    int slot_value = 1 << 30;
+    for (int i = 0; i < 4; i++) {
+        TTEntry *e = &b->entries[i];
+        uint64_t data = tt_load(&e->data);
+        if (!data || (tt_load(&e->check) ^ data) == key) { slot = e; break; }
+        int value = TT_DEPTH(data) - (TT_AGE(data) != t->age ? 64 : 0);
+        if (value < slot_value) { slot = e; slot_value = value; }
+    }
+    uint64_t data = tt_pack(score, depth, flag, best, t->age);
+    tt_write(&slot->check, key ^ data);
+    tt_write(&slot->data, data);
+}
+
+// ---------- EVALUATION ----------
+
+/**
+ * Static score of a position from the side to move's point of view
+ * Material, advancement, back rank and center (see eval.c) - the moves already kept g->eval up to
+ * date, so all that's left here is picking the sign
+ * A -DCHECKERS_NN build with a weights file loaded asks the net instead (see nn.c), kept well
+ * away from the win scores
+ */
+#define NN_MAX_SCORE 10000
+
+int evaluate(GameState *g) {
+    STAT_TIMER_START(EVAL);
+    int red_score = g->eval;
+#ifdef CHECKERS_NN
+    if (nn_loaded) {
+        red_score = nn_forward(g->nn_acc);
+        if (red_score > NN_MAX_SCORE) red_score = NN_MAX_SCORE;
+        if (red_score < -NN_MAX_SCORE) red_score = -NN_MAX_SCORE;
+    }
+#endif
+    int score = g->turn == 0 ? red_score : -red_score;
+    STAT_TIMER_STOP(EVAL);
+    return score;
+}
+
+// Tablebase value -> search score, a win in d plies from here scores like a search win found d plies deeper
+static int tb_score(int v, int ply) {
+    if (TB_IS_WIN(v)) return WIN_SCORE - ply - TB_DIST(v);
+    if (TB_IS_LOSS(v)) return -WIN_SCORE + ply + TB_DIST(v);
+    return 0;
+}
+
+// ---------- SEARCH ----------
+
+#define MAX_THREADS 64
+
+// ---------- PER-THREAD ARENA ----------
+
+/**
+ * Everything the search needs at one ply: the move list, the ordering scores, the undo record and
+ * the best line found from here down. alpha_beta()/quiesce() at ply p only ever use frames[p],
+ * so nothing in the tree needs the stack for big arrays and nothing ever gets allocated
+ * Starts on a cache line, so neighbouring plies never share one
+ */
+typedef struct {
+    _Alignas(64) MoveList moves;
+    int scores[MAX_MOVES];
+    Undo undo;
+    int pv_length;
+    Move pv[MAX_PLY];       // best line from this ply on, pv[0] is the move played here
+} PlyFrame;
+
+/**
+ * One block of memory per search thread, handed out front to back with a bump pointer
+ * It gets mapped the first time the thread searches and then kept for the engine's whole life,
+ * a new search just moves the pointer back to the start (arena_reset()), so after the first search
+ * no search ever calls malloc/free. The thread that searches with it is the first one to write
+ * to its pages, so on a NUMA machine the kernel puts them on that thread's node
+ */
+typedef struct {
+    unsigned char *base;    // NULL = not mapped yet
+    size_t size;
+    size_t used;
+} SearchArena;
+
+#define SEARCH_ARENA_SIZE (((MAX_PLY + 1) * sizeof(PlyFrame) + 4095) & ~(size_t)4095) // the frames, in whole pages
+
+static int arena_reserve(SearchArena *a, size_t size) {
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return 0; // Error catch - the search thread sits this one out
+    a->base = p;
+    a->size = size;
+    a->used = 0;
+    return 1;
+}
+
+// 'bytes' off the arena on a 64 byte boundary, NULL if it's full
+static void *arena_alloc(SearchArena *a, size_t bytes) {
+    size_t start = (a->used + 63) & ~(size_t)63;
+    if (!a->base || start + bytes > a->size) return NULL;
+    a->used = start + bytes;
+    return a->base + start;
+}
+
+// Everything handed out is free again, O(1) - the memory stays mapped for the next search
+static void arena_reset(SearchArena *a) { a->used = 0; }
+
+static void arena_release(SearchArena *a) {
+    if (a->base) munmap(a->base, a->size);
+    memset(a, 0, sizeof(*a));
+}
+
+/**
+ * Everything one search thread needs to keep track of, separate from the table so it gets wiped
+ * each search (except the arena, which gets reused). Only the table is shared between threads,
+ * each one has its own copy of this
+ */
+typedef struct SearchContext {
+    Engine *engine;         // the table and stop flag this thread shares with the others
+    SearchLimits limits;
+    double start;           // when the search started, from now_ms()
+    int id;                 // 0 = main thread (watches the clock), 1+ = helpers
+    int stopped;            // set once the search is over, everything unwinds after that
+    uint64_t nodes;
+    GameState pos;          // this thread's own copy of the position, make/unmake work on it
+    Move best;              // result of the deepest depth this thread finished
+    int score, depth;
+    Move killers[MAX_PLY][2];   // quiet moves that caused a beta cut at this ply
+    int history[64][64];        // from/to pairs that keep causing cuts anywhere
+    Move pv[MAX_PLY];           // principal variation of the deepest depth this thread finished
+    int pv_length;
+    SearchArena arena;          // kept from search to search
+    PlyFrame *frames;           // MAX_PLY + 1 of them, out of the arena
+} SearchContext;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int same_move(const Move *a, const Move *b) {
+    return a->from == b->from && a->to == b->to && a->captures == b->captures;
+}
+
+/**
+ * Give each move an ordering score, higher gets searched first
+ * Table move >> captures (more pieces first) >> killers >> history
+ */
+static void score_moves(SearchContext *ctx, MoveList *list, int *scores, const TTData *tte, int ply) {
+    for (int i = 0; i < list->count; i++) {
+        Move *m = &list->moves[i];
+        if (tte && m->from == tte->from && m->to == tte->to) scores[i] = 1 << 30;
+        else if (m->captures) scores[i] = (1 << 28) + count_bits(m->captures);
+        else if (same_move(m, &ctx->killers[ply][0])) scores[i] = (1 << 27) + 1;
+        else if (same_move(m, &ctx->killers[ply][1])) scores[i] = 1 << 27;
+        else scores[i] = ctx->history[m->from][m->to];
+    }
+}
+
+// Swap the best remaining move into slot i (selection sort one step at a time, most nodes cut early anyway)
+static void pick_move(MoveList *list, int *scores, int i) {
+    int best = i;
+    for (int j = i + 1; j < list->count; j++)
+        if (scores[j] > scores[best]) best = j;
+    if (best != i) {
+        Move tm = list->moves[i]; list->moves[i] = list->moves[best]; list->moves[best] = tm;
+        int ts = scores[i]; scores[i] = scores[best]; scores[best] = ts;
+    }
+}
+
+/**
+ * Check the clock every 1024 nodes, checking it every node would cost more than the search
+ * Only the main thread looks at the clock, helpers just see engine->stop go up
+ * A ponder search has no clock until the opponent plays the move it guessed: then the time limit
+ * counts from when the ponder search started, so the time spent pondering comes out of it (and if
+ * that's already used up it stops right away with what it has)
+ */
+static void check_time(SearchContext *ctx) {
+    if ((ctx->nodes & 1023) != 0) return;
+    if (ctx->id == 0) {
+        int ponder = __atomic_load_n(&ctx->engine->ponder, __ATOMIC_ACQUIRE);
+        if (ponder == PONDER_HIT) { // ctx->start stays where it was
+            __atomic_store_n(&ctx->engine->ponder, PONDER_OFF, __ATOMIC_RELAXED);
+            ponder = PONDER_OFF;
+        }
+        if (ponder == PONDER_MISS) {
+            __atomic_store_n(&ctx->engine->stop, 1, __ATOMIC_RELAXED);
+        } else if (ponder == PONDER_OFF && ctx->limits.time_ms > 0 && now_ms() - ctx->start >= ctx->limits.time_ms) {
+            __atomic_store_n(&ctx->engine->stop, 1, __ATOMIC_RELAXED);
+        }
+    }
+    if (__atomic_load_n(&ctx->engine->stop, __ATOMIC_RELAXED)) ctx->stopped = 1;
+}
+
+/**
+ * Quiescence - at depth 0 keep searching captures only, so we never stop in the middle of a trade
+ * With no jump on the board the side to move "stands pat" and takes the static score, but a jump
+ * is forced, so when there is one it has to be played out - no standing pat then
+ */
+static int quiesce(SearchContext *ctx, GameState *g, int alpha, int beta, int ply) {
+    ctx->nodes++;
+    STAT_INC(QNODES);
+    PlyFrame *f = &ctx->frames[ply];
+    f->pv_length = 0; // the line stops here, quiescence moves aren't part of it
+    check_time(ctx);
+    if (ctx->stopped) return 0;
+
+    if (!has_capture(g)) { // quiet - no need to generate anything
+        if (!has_step(g)) return -WIN_SCORE + ply; // no moves = lost
+        int stand = evaluate(g);
+        return stand > alpha ? stand : alpha;
+    }
+    if (ply >= MAX_PLY - 1) return evaluate(g);
+
+    MoveList *list = &f->moves;
+    generate_captures(g, list);
+    for (int i = 0; i < list->count; i++) {
+        make_move(g, list->moves[i], &f->undo);
+        int score = -quiesce(ctx, g, -beta, -alpha, ply + 1);
+        unmake_move(g, &f->undo);
+        if (ctx->stopped) return 0;
+        if (score >= beta) return score;
+        if (score > alpha) alpha = score;
+    }
+    return alpha;
+}
+
+static int alpha_beta(SearchContext *ctx, GameState *g, int depth, int alpha, int beta, int ply, Move *best_out) {
+    if (depth <= 0) return quiesce(ctx, g, alpha, beta, ply);
+
+    ctx->nodes++;
+    STAT_INC(NODES);
+    PlyFrame *f = &ctx->frames[ply];
+    f->pv_length = 0;
+    check_time(ctx);
+    if (ctx->stopped) return 0;
+
+    // Few enough pieces for the endgame table - that's the exact answer, no need to search at all
+    if (ply > 0 && tb.max_pieces && tb_pieces(g) <= tb.max_pieces) {
+        int v = tb_probe(g);
+        if (v != TB_NOT_FOUND) return tb_score(v, ply);
+    }
+
+    uint64_t key = g->hash; // kept up to date by apply_move()/switch_turn(), no rehashing here
+    TTData tte;
+    int tt_hit = tt_probe(&ctx->engine->tt, key, &tte);
+    if (tt_hit && ply > 0 && tte.depth >= depth) { // good enough result from before, skip the work
+        int s = score_from_tt(tte.score, ply);
+        if (tte.flag == TT_EXACT) return s;
+        if (tte.flag == TT_LOWER && s >= beta) return s;
+        if (tte.flag == TT_UPPER && s <= alpha) return s;
+    }
+
+    MoveList *list = &f->moves;
+    generate_moves(g, list);
+    if (list->count == 0) return -WIN_SCORE + ply; // no moves = lost
+    if (ply >= MAX_PLY - 1) return evaluate(g);
+
+    int *scores = f->scores;
+    score_moves(ctx, list, scores, tt_hit ? &tte : NULL, ply);
+
+    int orig_alpha = alpha;
+    int best_score = -INF_SCORE;
+    Move best = list->moves[0];
+
+    for (int i = 0; i < list->count; i++) {
+        pick_move(list, scores, i);
+        Move *m = &list->moves[i];
+
+        make_move(g, *m, &f->undo);
+        int score = -alpha_beta(ctx, g, depth - 1, -beta, -alpha, ply + 1, NULL);
+        unmake_move(g, &f->undo); // always put the move back before anything else, even if time ran out
+        if (ctx->stopped) return 0;
+
+        if (score > best_score) { best_score = score; best = *m; }
+        if (score > alpha) { // new best line: this move + the child's line
+            alpha = score;
+            PlyFrame *child = &ctx->frames[ply + 1];
+            f->pv[0] = *m;
+            memcpy(&f->pv[1], child->pv, (size_t)child->pv_length * sizeof(Move));
+            f->pv_length = child->pv_length + 1;
+        }
+        if (alpha >= beta) {
+            if (!m->captures) { // remember quiet moves that cut, captures get searched early anyway
+                if (!same_move(m, &ctx->killers[ply][0])) {
+                    ctx->killers[ply][1] = ctx->killers[ply][0];
+                    ctx->killers[ply][0] = *m;
+                }
+                ctx->history[m->from][m->to] += depth * depth;
+            }
+            break;
+        }
+    }
+
+    int flag = best_score <= orig_alpha ? TT_UPPER : best_score >= beta ? TT_LOWER : TT_EXACT;
+    tt_store(&ctx->engine->tt, key, depth, score_to_tt(best_score, ply), flag, &best);
+    if (best_out) *best_out = best;
+    return best_score;
+}
+
+/**
+ * Lazy SMP depth perturbation - if every helper searched depth 1, 2, 3... in step with the main
+ * thread they'd all walk the same tree at the same time. Helper i skips some depths using these
+ * (same idea as Stockfish's old skip tables), so at any moment the threads are spread over the
+ * next few depths and fill the table with results the main thread is about to need
+ */
+static const int skip_size[16]  = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4};
+static const int skip_phase[16] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3};
+
+// Iterative deepening for one thread, keeps its answer from the last depth that finished in time
+static void *search_thread(void *arg) {
+    SearchContext *ctx = arg;
+    if (!ctx->arena.base) arena_reserve(&ctx->arena, SEARCH_ARENA_SIZE); // first search on this slot only
+    arena_reset(&ctx->arena);
+    ctx->frames = arena_alloc(&ctx->arena, (MAX_PLY + 1) * sizeof(PlyFrame));
+    if (!ctx->frames) { // Error catch - no memory, the other threads (or the first legal move) will have to do
+        if (ctx->id == 0) __atomic_store_n(&ctx->engine->stop, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    // helpers don't stop at the depth limit, they keep feeding the table until the main thread is done
+    int max_depth = ctx->id == 0 && ctx->limits.max_depth > 0 ? ctx->limits.max_depth : MAX_PLY - 1;
+    for (int depth = 1; depth <= max_depth; depth++) {
+        if (ctx->id > 0) {
+            int i = (ctx->id - 1) % 16;
+            if (((depth + skip_phase[i]) / skip_size[i]) % 2) continue;
+        }
+        Move best;
+        int score = alpha_beta(ctx, &ctx->pos, depth, -INF_SCORE, INF_SCORE, 0, &best);
+        if (ctx->stopped) break; // this depth didn't finish, keep the last one
+        ctx->best = best;
+        ctx->score = score;
+        ctx->depth = depth;
+        ctx->pv_length = ctx->frames[0].pv_length; // the frames get written over by the next depth
+        memcpy(ctx->pv, ctx->frames[0].pv, (size_t)ctx->pv_length * sizeof(Move));
+        if (score > WIN_SCORE - WIN_RANGE || score < -WIN_SCORE + WIN_RANGE) break; // found a forced win/loss
+    }
+    if (ctx->id == 0) __atomic_store_n(&ctx->engine->stop, 1, __ATOMIC_RELAXED); // main is done = everyone is done
+    return NULL;
+}
+
+/**
+ * Pick a move for the side to move in 'g' using engine 'e' (g is not changed)
+ * Runs depth 1, 2, 3... and keeps the answer from the last depth that finished in time
+ *
+ * With limits.threads > 1 it's Lazy SMP: every thread runs its own iterative deepening on its own
+ * copy of the position, and the only thing they share is the transposition table. Nobody hands
+ * out work - the helpers just search slightly different depths and fill the table, so the main
+ * thread finds most of its tree already done. The answer comes from whichever thread finished
+ * the deepest depth (the main thread if it's a tie)
+ */
+SearchResult engine_search(Engine *e, GameState *g, SearchLimits limits) {
+    SearchResult result;
+    memset(&result, 0, sizeof(result));
+    if (!e->tt.buckets && !tt_alloc(&e->tt, TT_DEFAULT_MB)) return result; // Error catch - no memory for the table
+    e->tt.age++;
+
+    MoveList list;
+    generate_moves(g, &list);
+    if (list.count == 0) return result; // nothing to play
+    result.best = list.moves[0]; // something legal in case not even depth 1 finishes
+    result.has_move = 1;
+
+    int threads = limits.threads < 1 ? 1 : limits.threads > MAX_THREADS ? MAX_THREADS : limits.threads;
+    if (e->ctx_count < threads) { // big (history tables), so on the heap and only grown once
+        SearchContext *grown = realloc(e->ctx, threads * sizeof(SearchContext));
+        if (grown) {
+            memset(grown + e->ctx_count, 0, (threads - e->ctx_count) * sizeof(SearchContext)); // new ones have no arena yet
+            e->ctx = grown;
+            e->ctx_count = threads;
+        }
+        else if (!e->ctx) return result; // Error catch - not even room for one thread, play the first move
+        threads = e->ctx_count;
+    }
+    STAT_TIMER_START(SEARCH); // after the early returns, so every start gets its stop
+    SearchContext *ctx = e->ctx;
+    double start = now_ms();
+    e->stop = 0;
+    for (int t = 0; t < threads; t++) {
+        SearchArena arena = ctx[t].arena; // the only thing that outlives a search
+        memset(&ctx[t], 0, sizeof(ctx[t]));
+        ctx[t].arena = arena;
+        ctx[t].engine = e;
+        ctx[t].limits = limits;
+        ctx[t].start = start;
+        ctx[t].id = t;
+        ctx[t].pos = *g;
+    }
+
+    pthread_t ids[MAX_THREADS];
+    int started = 1;
+    for (int t = 1; t < threads; t++, started++)
+        if (pthread_create(&ids[t], NULL, search_thread, &ctx[t]) != 0) break; // Error catch - search with what we have
+    search_thread(&ctx[0]); // main thread searches on the caller's thread
+    for (int t = 1; t < started; t++) pthread_join(ids[t], NULL);
+
+    SearchContext *winner = &ctx[0];
+    for (int t = 0; t < started; t++) {
+        result.nodes += ctx[t].nodes;
+        if (ctx[t].depth > winner->depth) winner = &ctx[t];
+    }
+    if (winner->depth > 0) {
+        result.best = winner->best;
+        result.score = winner->score;
+        result.depth = winner->depth;
+        result.pv_length = winner->pv_length;
+        memcpy(result.pv, winner->pv, (size_t)winner->pv_length * sizeof(Move));
+    }
+    result.seconds = (now_ms() - start) / 1000.0;
+    STAT_TIMER_STOP(SEARCH);
+    return result;
+}
+
+// Give back an engine's memory, it can still be used again afterwards (it just reallocates)
+void engine_free(Engine *e) {
+    for (int t = 0; t < e->ctx_count; t++) arena_release(&e->ctx[t].arena);
+    free(e->tt.buckets);
+    free(e->ctx);
+    memset(e, 0, sizeof(*e));
+}
+
+// search_position() with the game's own engine
+SearchResult search_position(GameState *g, SearchLimits limits) {
+    return engine_search(&default_engine, g, limits);
+}
+
+// ---------- PONDERING ----------
+
+/**
+ * Thinking on the opponent's time. After the engine moves, the second move of its PV is the reply
+ * it expects. ponder_start() plays that reply on a copy of the board and searches the result on a
+ * background thread, with no clock, while the opponent is still deciding (play_game() is sitting
+ * in scanf() the whole time, so it costs the human nothing)
+ *
+ * When the opponent's move is in, ponder_finish():
+ *   - guessed right: the background search just keeps going, and the time it already spent
+ *     pondering counts against its time limit (past it = answer at once). The depth it reached
+ *     on the opponent's time still comes for free
+ *   - guessed wrong: it gets stopped and a normal search runs on the real position. The table is
+ *     still full of what the ponder search looked at, so even that usually isn't wasted
+ *
+ * The engine belongs to the background thread until ponder_finish()/ponder_stop() - don't search
+ * with it in between
+ */
+typedef struct {
+    Engine *engine;
+    GameState pos;          // position after the predicted reply
+    SearchLimits limits;
+    SearchResult result;    // filled in by the thread
+    Move predicted;
+    pthread_t thread;
+    int running;
+    int hit;                // after ponder_finish(): 1 if the opponent played the predicted move
+} Ponder;
+
+static void *ponder_thread(void *arg) {
+    Ponder *p = arg;
+    p->result = engine_search(p->engine, &p->pos, p->limits);
+    return NULL;
+}
+
+/**
+ * Start pondering on 'e'. 'g' is the position with the opponent to move, 'last' the engine's
+ * search that just got played (its PV has the predicted reply)
+ * Returns 1 if a ponder search is running, 0 if there was nothing to predict
+ */
+int ponder_start(Ponder *p, Engine *e, const GameState *g, const SearchResult *last, SearchLimits limits) {
+    memset(p, 0, sizeof(*p));
+    if (last->pv_length < 2) return 0; // book move or a search too short to have a guess
+    p->pos = *g;
+    MoveList list;
+    generate_moves(&p->pos, &list);
+    int legal = 0;
+    for (int i = 0; i < list.count && !legal; i++) legal = same_move(&list.moves[i], &last->pv[1]);
+    if (!legal) return 0; // Error catch - the PV doesn't fit this position
+
+    p->engine = e;
+    p->predicted = last->pv[1];
+    apply_move(&p->pos, &p->predicted);
+    switch_turn(&p->pos);
+    p->limits = limits;
+    __atomic_store_n(&e->ponder, PONDER_ON, __ATOMIC_RELEASE);
+    if (pthread_create(&p->thread, NULL, ponder_thread, p) != 0) { // Error catch - no thread, just don't ponder
+        e->ponder = PONDER_OFF;
+        return 0;
+    }
+    p->running = 1;
+    return 1;
+}
+
+/**
+ * The opponent has moved and it's the engine's turn in 'g': the answer for 'g', from the ponder
+ * search if it guessed right (p->hit = 1), otherwise from a fresh search with 'limits'
+ */
+SearchResult ponder_finish(Ponder *p, GameState *g, SearchLimits limits) {
+    if (!p->running) return engine_search(p->engine ? p->engine : &default_engine, g, limits);
+    double moved = now_ms();
+    p->hit = g->hash == p->pos.hash && g->red == p->pos.red && g->black == p->pos.black &&
+             g->red_kings == p->pos.red_kings && g->black_kings == p->pos.black_kings;
+    __atomic_store_n(&p->engine->ponder, p->hit ? PONDER_HIT : PONDER_MISS, __ATOMIC_RELEASE);
+    pthread_join(p->thread, NULL);
+    p->engine->ponder = PONDER_OFF;
+    p->running = 0;
+    if (p->hit) {
+        p->result.seconds = (now_ms() - moved) / 1000.0; // only the time after the opponent moved
+        return p->result;
+    }
+    return engine_search(p->engine, g, limits);
+}
+
+// Throw away a ponder search (game over, quitting, or a book move instead)
+void ponder_stop(Ponder *p) {
+    if (!p->running) return;
+    __atomic_store_n(&p->engine->ponder, PONDER_MISS, __ATOMIC_RELEASE);
+    pthread_join(p->thread, NULL);
+    p->engine->ponder = PONDER_OFF;
+    p->running = 0;
+}
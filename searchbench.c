@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#define CHECKERS_NO_MAIN // search + rules out of checkers.c, our own main()
+#include "checkers.c"
+
+/**
+ * Search scaling benchmark - how much faster does Lazy SMP get to a depth with more threads
+ *
+ * Usage: ./searchbench [-d depth] [-t threads] [-m table_mb]   (defaults: depth 14, every core, 64 MB)
+ *
+ * Plays a short game from the start to get a handful of positions (opening through middlegame),
+ * then searches every one of them to the same fixed depth with 1 thread, 2, 4... up to -t.
+ * The table gets cleared before every search so no run gets a head start from the one before.
+ *
+ * Time to depth is what matters for playing strength, so that's what gets compared:
+ *   speedup    = time with 1 thread / time with n threads
+ *   efficiency = speedup / n      (1.00 = perfect scaling)
+ * Nodes/s goes up almost perfectly with threads, but a lot of those nodes are helpers searching
+ * what another thread already did, so it says very little on its own
+ */
+
+#define BENCH_POSITIONS 6
+#define BENCH_SPACING 6     // plies between benchmark positions
+
+// Positions from a game the engine plays against itself at a low depth (same every run)
+static int bench_positions(GameState *out) {
+    GameState g;
+    init_board(&g);
+    SearchLimits quick = {4, 0, 1};
+    int n = 0;
+    for (int ply = 0; n < BENCH_POSITIONS; ply++) {
+        if (ply % BENCH_SPACING == 0) out[n++] = g;
+        SearchResult r = search_position(&g, quick);
+        if (!r.has_move) break; // game over early, use what we have
+        apply_move(&g, &r.best);
+        switch_turn(&g);
+    }
+    return n;
+}
+
+// Search every position with 'threads' threads, returns the total seconds and adds up the nodes
+static double bench_run(GameState *positions, int count, int depth, int threads, int mb, uint64_t *nodes) {
+    SearchLimits limits = {depth, 0, threads};
+    double total = 0;
+    *nodes = 0;
+    for (int i = 0; i < count; i++) {
+        tt_init(mb); // fresh table each search
+        SearchResult r = search_position(&positions[i], limits);
+        total += r.seconds;
+        *nodes += r.nodes;
+    }
+    return total;
+}
+
+int main(int argc, char **argv) {
+    int depth = 14, mb = 64;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-d") == 0) depth = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-t") == 0) threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-m") == 0) mb = atoi(argv[i + 1]);
+    }
+    if (depth < 1 || depth >= MAX_PLY) { printf("Depth must be 1-%d.\n", MAX_PLY - 1); return 1; }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (mb < 1 || !tt_init(mb)) { printf("Can't allocate a %d MB table.\n", mb); return 1; } // Error catch
+
+    GameState positions[BENCH_POSITIONS];
+    int count = bench_positions(positions);
+    printf("%d positions, depth %d, %d MB table\n\n", count, depth, mb);
+    printf("threads      time        nodes     nodes/s   speedup  efficiency\n");
+
+    double base = 0;
+    for (int t = 1; ; t = t * 2 > threads && t < threads ? threads : t * 2) {
+        uint64_t nodes;
+        double secs = bench_run(positions, count, depth, t, mb, &nodes);
+        if (t == 1) base = secs;
+        double speedup = secs > 0 ? base / secs : 0;
+        printf("%7d %8.3f s %12llu %11.0f %8.2fx %10.2f\n", t, secs, (unsigned long long)nodes,
+               secs > 0 ? nodes / secs : 0.0, speedup, speedup / t);
+        if (t >= threads) break;
+    }
+    return 0;
+}
@@ -0,0 +1,730 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#define CHECKERS_NO_MAIN // rules + search out of checkers.c, our own main()
+#include "checkers.c"
+
+/**
+ * Game server - thousands of games in one process instead of one ./checkers per game, all talking
+ * over one Unix or TCP socket
+ *
+ * Usage: ./server [-u path | -p port] [-w workers] [-ms n] [-d depth] [-mb n] [-g games]
+ *   -u path     Unix socket (default checkers.sock), -p port = TCP on localhost instead
+ *   -w workers  engine threads (default every core), each with its own -mb MB table (default 16)
+ *   -ms / -d    engine time / depth per reply for games that don't say (default 100 ms)
+ *   -g games    most games at once (default 10000), every one of them is allocated up front
+ * Ctrl-C stops it and prints the latency numbers
+ *
+ * One event loop thread owns every socket and every game: non-blocking sockets on epoll (poll()
+ * where there's no epoll, or with -DSERVER_POLL). It never waits on anything but the event loop,
+ * the searches run on the worker pool and come back through a pipe the loop is also watching.
+ * Clients can keep lots of games going on one connection and send the next command before the
+ * last answer is back
+ *
+ * Commands, one per line, moves in standard notation (see parse_move()):
+ *   new [red|black] [depth n] [ms n]  -> game <id>       you play that color (default red), the
+ *                                                         engine plays the other and moves first if it's red
+ *   move <id> <m>                     -> reply <id> <m>  once the engine has answered (or "over")
+ *   legal <id>                        -> legal <id> m1 m2 ...
+ *   board <id>                        -> board <id> r|b red black rkings bkings   (hex, same as perft)
+ *   end <id>                          -> ended <id>      (games also end when their connection closes)
+ *   stats                             -> stats games n connections n moves n p50 .. p90 .. p99 .. p999 .. max .. other n p50 .. p99 .. max ..
+ *   quit
+ * A game that's over gets "over <id> red|black" (the winner) instead of a reply. Anything wrong
+ * gets "error <why>", and a move while the engine is still thinking gets "error <id> busy"
+ *
+ * Latency = from the moment the request's line came in until its answer is queued to go out, in
+ * microseconds. Moves (which wait for a search) and everything else are kept apart
+ */
+
+#if defined(__linux__) && !defined(SERVER_POLL)
+#include <sys/epoll.h>
+#define SERVER_EPOLL 1
+#else
+#define SERVER_EPOLL 0
+#endif
+
+#define SERVER_MAX_LINE 512
+#define SERVER_OUT_SIZE 65536       // per connection, a client that never reads gets dropped when it fills up
+#define SERVER_DEFAULT_GAMES 10000
+#define SERVER_DEFAULT_SOCKET "checkers.sock"
+#define SERVER_MAX_EVENTS 256
+
+typedef struct {
+    const char *unix_path;  // used if tcp_port is 0
+    int tcp_port;
+    int workers;
+    int table_mb;
+    int max_games;
+    SearchLimits limits;    // per engine reply, unless the game says otherwise
+} ServerConfig;
+
+typedef struct {
+    GameState g;
+    SearchLimits limits;
+    int in_use;
+    int thinking;           // a reply is queued or being searched, moves get refused until it's back (and the
+                            // slot can't be reused - a worker might still be reading its job)
+    int engine_side;        // turn value the engine moves on
+    int owner;              // fd of the connection that started it
+    uint64_t owner_gen;     // ... and which connection on that fd it was
+    uint32_t gen;           // goes up every time the game in the slot ends, a reply queued before that gets dropped
+} Session;
+
+// One search for the worker pool. A game has at most one at a time, so there's one slot per game
+typedef struct {
+    uint32_t gen;           // Session.gen when it was queued
+    GameState g;
+    SearchLimits limits;
+    double received;        // when the request behind it came in (now_ms())
+    Move best;              // filled in by the worker
+    int has_move;
+} Job;
+
+typedef struct {
+    int fd;
+    uint64_t gen;
+    char in[SERVER_MAX_LINE];
+    size_t in_len;
+    char *out;
+    size_t out_len;
+    int writing;            // waiting for the socket to take the rest of 'out'
+    int closing;            // quit, or out filled up: close once 'out' is gone (or right away)
+} Conn;
+
+// ---------- LATENCY ----------
+
+/**
+ * Log-linear histogram in microseconds: exact below 16, then every power of two split into 16
+ * buckets, so any percentile is within about 6% for a fixed 1 KB per histogram and no sorting
+ */
+#define LAT_SUB 16
+#define LAT_BUCKETS (61 * LAT_SUB)
+
+typedef struct {
+    uint64_t counts[LAT_BUCKETS];
+    uint64_t total, max;
+} LatencyHistogram;
+
+static int lat_bucket(uint64_t us) {
+    if (us < LAT_SUB) return (int)us;
+    int top = 63 - __builtin_clzll(us); // 4 or more here
+    return (top - 3) * LAT_SUB + (int)((us >> (top - 4)) & (LAT_SUB - 1));
+}
+
+// Smallest value that lands in bucket 'b'
+static uint64_t lat_bucket_floor(int b) {
+    if (b < LAT_SUB) return (uint64_t)b;
+    int top = b / LAT_SUB + 3;
+    return (uint64_t)(LAT_SUB + b % LAT_SUB) << (top - 4);
+}
+
+static void lat_record(LatencyHistogram *h, double ms) {
+    uint64_t us = ms > 0 ? (uint64_t)(ms * 1000) : 0;
+    int b = lat_bucket(us);
+    h->counts[b < LAT_BUCKETS ? b : LAT_BUCKETS - 1]++;
+    h->total++;
+    if (us > h->max) h->max = us;
+}
+
+// Value below which 'p' (0..1) of everything recorded falls
+static uint64_t lat_percentile(const LatencyHistogram *h, double p) {
+    if (h->total == 0) return 0;
+    uint64_t want = (uint64_t)(p * (double)h->total), seen = 0;
+    if (want >= h->total) want = h->total - 1;
+    for (int b = 0; b < LAT_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen > want) return lat_bucket_floor(b);
+    }
+    return h->max;
+}
+
+// ---------- STATE ----------
+
+static ServerConfig server_cfg;
+static Session *sessions;
+static Job *jobs;
+static int *free_sessions, free_count;  // stack of unused session slots
+static int active_games;
+static Conn **conns;                    // by fd
+static int conn_cap, conn_count;
+static uint64_t next_conn_gen = 1;
+static LatencyHistogram lat_moves, lat_other;
+static int server_stopping;             // __atomic, server_stop() can come from any thread or a signal
+static int wake_pipe[2] = {-1, -1};     // workers (and server_stop()) write a byte, the event loop wakes up. Made once, kept
+static int listen_fd = -1;
+
+// Worker pool queues: session numbers, each ring big enough for every game at once
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_ready = PTHREAD_COND_INITIALIZER;
+static int *todo, todo_head, todo_count;
+static int *done, done_head, done_count;
+static int workers_quit;
+
+static void wake_loop(void) {
+    char c = 1;
+    ssize_t n = write(wake_pipe[1], &c, 1); // pipe full = the loop is already going to wake up
+    (void)n;
+}
+
+// ---------- EVENT LOOP BACKEND ----------
+
+#if SERVER_EPOLL
+static int ev_fd = -1;
+
+static int ev_init(void) { ev_fd = epoll_create1(0); return ev_fd >= 0; }
+
+static int ev_add(int fd) {
+    struct epoll_event e = {.events = EPOLLIN, .data.fd = fd};
+    return epoll_ctl(ev_fd, EPOLL_CTL_ADD, fd, &e) == 0;
+}
+
+static void ev_want_write(int fd, int on) {
+    struct epoll_event e = {.events = EPOLLIN | (on ? EPOLLOUT : 0), .data.fd = fd};
+    epoll_ctl(ev_fd, EPOLL_CTL_MOD, fd, &e);
+}
+
+static void ev_del(int fd) { epoll_ctl(ev_fd, EPOLL_CTL_DEL, fd, NULL); }
+
+// Ready fds into fds[]/flags[] (1 = readable, 2 = writable), returns how many
+static int ev_wait(int *fds, int *flags, int max, int timeout_ms) {
+    struct epoll_event evs[SERVER_MAX_EVENTS];
+    int n = epoll_wait(ev_fd, evs, max < SERVER_MAX_EVENTS ? max : SERVER_MAX_EVENTS, timeout_ms);
+    for (int i = 0; i < n; i++) {
+        fds[i] = evs[i].data.fd;
+        flags[i] = (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR) ? 1 : 0) | (evs[i].events & EPOLLOUT ? 2 : 0);
+    }
+    return n < 0 ? 0 : n;
+}
+
+static void ev_close(void) { if (ev_fd >= 0) close(ev_fd); ev_fd = -1; }
+
+#else // poll() - one pollfd per fd, slot[fd] says where it is so removing one is a swap with the last
+
+static struct pollfd *ev_polls;
+static int *ev_slot, ev_count, ev_cap, ev_next; // ev_next: where the last ev_wait() stopped, so busy fds can't starve the rest
+
+static int ev_init(void) { return 1; }
+
+static int ev_add(int fd) {
+    if (fd >= ev_cap) {
+        int cap = fd * 2 + 64;
+        struct pollfd *p = realloc(ev_polls, (size_t)cap * sizeof(*p));
+        if (!p) return 0;
+        ev_polls = p;
+        int *s = realloc(ev_slot, (size_t)cap * sizeof(*s));
+        if (!s) return 0;
+        ev_slot = s;
+        ev_cap = cap;
+    }
+    ev_polls[ev_count] = (struct pollfd){fd, POLLIN, 0};
+    ev_slot[fd] = ev_count++;
+    return 1;
+}
+
+static void ev_want_write(int fd, int on) { ev_polls[ev_slot[fd]].events = POLLIN | (on ? POLLOUT : 0); }
+
+static void ev_del(int fd) {
+    int s = ev_slot[fd];
+    ev_polls[s] = ev_polls[--ev_count];
+    ev_slot[ev_polls[s].fd] = s;
+}
+
+static int ev_wait(int *fds, int *flags, int max, int timeout_ms) {
+    if (poll(ev_polls, (nfds_t)ev_count, timeout_ms) <= 0) return 0;
+    int n = 0;
+    for (int k = 0; k < ev_count && n < max; k++) {
+        struct pollfd *p = &ev_polls[(ev_next + k) % ev_count];
+        if (!p->revents) continue;
+        fds[n] = p->fd;
+        flags[n++] = (p->revents & (POLLIN | POLLHUP | POLLERR) ? 1 : 0) | (p->revents & POLLOUT ? 2 : 0);
+    }
+    ev_next = ev_count ? (ev_next + 1) % ev_count : 0;
+    return n;
+}
+
+static void ev_close(void) { free(ev_polls); free(ev_slot); ev_polls = NULL; ev_slot = NULL; ev_count = ev_cap = 0; }
+#endif
+
+// ---------- WORKERS ----------
+
+static void *server_worker(void *arg) {
+    (void)arg;
+    Engine engine;
+    memset(&engine, 0, sizeof(engine));
+    if (!tt_alloc(&engine.tt, server_cfg.table_mb)) { // Error catch - the other workers will have to do
+        fprintf(stderr, "Out of memory for a worker's table.\n");
+        return NULL;
+    }
+    pthread_mutex_lock(&queue_lock);
+    while (1) {
+        while (todo_count == 0 && !workers_quit) pthread_cond_wait(&queue_ready, &queue_lock);
+        if (workers_quit) break;
+        int s = todo[todo_head];
+        todo_head = (todo_head + 1) % server_cfg.max_games;
+        todo_count--;
+        pthread_mutex_unlock(&queue_lock);
+
+        Job *j = &jobs[s];
+        Move m;
+        if (book_probe(&j->g, &m)) { j->best = m; j->has_move = 1; }
+        else {
+            SearchResult r = engine_search(&engine, &j->g, j->limits);
+            j->best = r.best;
+            j->has_move = r.has_move;
+        }
+
+        pthread_mutex_lock(&queue_lock);
+        done[(done_head + done_count) % server_cfg.max_games] = s;
+        done_count++;
+        wake_loop();
+    }
+    pthread_mutex_unlock(&queue_lock);
+    engine_free(&engine);
+    return NULL;
+}
+
+// Hand session 's' to the worker pool for the engine's move
+static void queue_engine_move(int s, double received) {
+    Session *se = &sessions[s];
+    se->thinking = 1;
+    jobs[s].gen = se->gen;
+    jobs[s].g = se->g;
+    jobs[s].limits = se->limits;
+    jobs[s].received = received;
+    pthread_mutex_lock(&queue_lock);
+    todo[(todo_head + todo_count) % server_cfg.max_games] = s;
+    todo_count++;
+    pthread_cond_signal(&queue_ready);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+// ---------- CONNECTIONS ----------
+
+// printf onto a connection's output. Doesn't fit = the client isn't reading, it gets dropped
+static void conn_printf(Conn *c, const char *fmt, ...) {
+    if (c->closing) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(c->out + c->out_len, SERVER_OUT_SIZE - c->out_len, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= SERVER_OUT_SIZE - c->out_len) { c->closing = 1; c->out_len = 0; return; }
+    c->out_len += (size_t)n;
+}
+
+// Write what the socket takes now, and have the loop tell us when it can take the rest
+static void conn_flush(Conn *c) {
+    size_t sent = 0;
+    while (sent < c->out_len) {
+        ssize_t n = send(c->fd, c->out + sent, c->out_len - sent, 0);
+        if (n > 0) { sent += (size_t)n; continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        c->closing = 1; // Error catch - client went away
+        c->out_len = 0;
+        return;
+    }
+    memmove(c->out, c->out + sent, c->out_len - sent);
+    c->out_len -= sent;
+    int want = c->out_len > 0;
+    if (want != c->writing) { ev_want_write(c->fd, want); c->writing = want; }
+}
+
+// A game still waiting on the engine only gets its slot back once the reply is in (collect_replies())
+static void end_session(int s) {
+    sessions[s].in_use = 0;
+    sessions[s].gen++; // the reply still on its way for it gets dropped
+    if (!sessions[s].thinking) free_sessions[free_count++] = s;
+    active_games--;
+}
+
+static void conn_close(Conn *c) {
+    for (int s = 0; s < server_cfg.max_games; s++) // its games go with it (only on disconnect, so a scan is fine)
+        if (sessions[s].in_use && sessions[s].owner == c->fd && sessions[s].owner_gen == c->gen) end_session(s);
+    ev_del(c->fd);
+    close(c->fd);
+    conns[c->fd] = NULL;
+    conn_count--;
+    free(c->out);
+    free(c);
+}
+
+static Conn *owner_conn(const Session *se) {
+    Conn *c = se->owner < conn_cap ? conns[se->owner] : NULL;
+    return c && c->gen == se->owner_gen ? c : NULL;
+}
+
+static void accept_clients(void) {
+    while (1) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) return; // EAGAIN = that's all of them (anything else, try again next time)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        if (server_cfg.tcp_port) { int one = 1; setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); }
+        if (fd >= conn_cap) {
+            int cap = fd * 2 + 64;
+            Conn **grown = realloc(conns, (size_t)cap * sizeof(Conn *));
+            if (!grown) { close(fd); continue; } // Error catch - no room for another client
+            memset(grown + conn_cap, 0, (size_t)(cap - conn_cap) * sizeof(Conn *));
+            conns = grown;
+            conn_cap = cap;
+        }
+        Conn *c = calloc(1, sizeof(Conn));
+        if (c) c->out = malloc(SERVER_OUT_SIZE);
+        if (!c || !c->out || !ev_add(fd)) { if (c) free(c->out); free(c); close(fd); continue; } // Error catch - same
+        c->fd = fd;
+        c->gen = next_conn_gen++;
+        conns[fd] = c;
+        conn_count++;
+    }
+}
+
+// ---------- COMMANDS ----------
+
+// tok = "<id>" of a game this connection started, or -1 (with the error already sent)
+static int own_session(Conn *c, const char *tok) {
+    char *end;
+    long s = tok ? strtol(tok, &end, 10) : -1;
+    if (!tok || *end || s < 0 || s >= server_cfg.max_games || !sessions[s].in_use ||
+        sessions[s].owner != c->fd || sessions[s].owner_gen != c->gen) {
+        conn_printf(c, "error no game %s\n", tok ? tok : "");
+        return -1;
+    }
+    return (int)s;
+}
+
+// Side to move has no moves = the other side won. Returns 1 (and says so) if that's the case
+static int game_over(Conn *c, int s) {
+    MoveList list;
+    generate_moves(&sessions[s].g, &list);
+    if (list.count > 0) return 0;
+    if (c) conn_printf(c, "over %d %s\n", s, sessions[s].g.turn == 0 ? "black" : "red");
+    return 1;
+}
+
+static void command_new(Conn *c, char **tok, int n) {
+    if (free_count == 0) { conn_printf(c, "error full\n"); return; }
+    int human = 0;
+    SearchLimits limits = server_cfg.limits;
+    for (int i = 1; i < n; i++) {
+        if (strcmp(tok[i], "red") == 0) human = 0;
+        else if (strcmp(tok[i], "black") == 0) human = 1;
+        else if (strcmp(tok[i], "depth") == 0 && i + 1 < n) { limits.max_depth = atoi(tok[++i]); limits.time_ms = 0; }
+        else if (strcmp(tok[i], "ms") == 0 && i + 1 < n) limits.time_ms = atoi(tok[++i]);
+        else { conn_printf(c, "error bad option %s\n", tok[i]); return; }
+    }
+    if (limits.max_depth <= 0 && limits.time_ms <= 0) limits.time_ms = 100; // Error catch - has to stop somehow
+    limits.threads = 1; // the pool is the parallelism
+
+    int s = free_sessions[--free_count];
+    Session *se = &sessions[s];
+    init_board(&se->g);
+    se->limits = limits;
+    se->in_use = 1;
+    se->thinking = 0;
+    se->engine_side = 1 - human;
+    se->owner = c->fd;
+    se->owner_gen = c->gen;
+    active_games++;
+    conn_printf(c, "game %d\n", s);
+    if (se->engine_side == 0) queue_engine_move(s, now_ms());
+}
+
+// Returns 1 if the answer waits for the engine (latency gets recorded when it comes back)
+static int command_move(Conn *c, char **tok, int n, double received) {
+    int s = own_session(c, n > 1 ? tok[1] : NULL);
+    if (s < 0) return 0;
+    Session *se = &sessions[s];
+    if (se->thinking) { conn_printf(c, "error %d busy\n", s); return 0; }
+    if (n < 3) { conn_printf(c, "error %d no move\n", s); return 0; }
+    Move m;
+    if (se->g.turn == se->engine_side || !parse_move(&se->g, tok[2], &m)) { conn_printf(c, "error %d illegal move %s\n", s, tok[2]); return 0; }
+    apply_move(&se->g, &m);
+    switch_turn(&se->g);
+    if (game_over(c, s)) return 0;
+    queue_engine_move(s, received);
+    return 1;
+}
+
+static void command_stats(Conn *c) {
+    conn_printf(c, "stats games %d connections %d moves %llu p50 %llu p90 %llu p99 %llu p999 %llu max %llu "
+                   "other %llu p50 %llu p99 %llu max %llu\n", active_games, conn_count,
+                (unsigned long long)lat_moves.total, (unsigned long long)lat_percentile(&lat_moves, 0.5),
+                (unsigned long long)lat_percentile(&lat_moves, 0.9), (unsigned long long)lat_percentile(&lat_moves, 0.99),
+                (unsigned long long)lat_percentile(&lat_moves, 0.999), (unsigned long long)lat_moves.max,
+                (unsigned long long)lat_other.total, (unsigned long long)lat_percentile(&lat_other, 0.5),
+                (unsigned long long)lat_percentile(&lat_other, 0.99), (unsigned long long)lat_other.max);
+}
+
+#define SERVER_MAX_TOKENS 16
+
+static void run_command(Conn *c, char *line) {
+    double received = now_ms();
+    char *tok[SERVER_MAX_TOKENS], *save;
+    int n = 0;
+    for (char *t = strtok_r(line, " \t\r", &save); t && n < SERVER_MAX_TOKENS; t = strtok_r(NULL, " \t\r", &save)) tok[n++] = t;
+    if (n == 0) return; // blank line
+    const char *cmd = tok[0];
+
+    if (strcmp(cmd, "move") == 0) { if (command_move(c, tok, n, received)) return; }
+    else if (strcmp(cmd, "new") == 0) command_new(c, tok, n);
+    else if (strcmp(cmd, "legal") == 0) {
+        int s = own_session(c, n > 1 ? tok[1] : NULL);
+        if (s >= 0) {
+            MoveList list;
+            generate_moves(&sessions[s].g, &list);
+            conn_printf(c, "legal %d", s);
+            for (int i = 0; i < list.count; i++) {
+                char text[MOVE_TEXT_SIZE];
+                move_to_text(&list.moves[i], text);
+                conn_printf(c, " %s", text);
+            }
+            conn_printf(c, "\n");
+        }
+    }
+    else if (strcmp(cmd, "board") == 0) {
+        int s = own_session(c, n > 1 ? tok[1] : NULL);
+        GameState *g = s >= 0 ? &sessions[s].g : NULL;
+        if (g) conn_printf(c, "board %d %c %016llx %016llx %016llx %016llx\n", s, g->turn ? 'b' : 'r',
+                           (unsigned long long)g->red, (unsigned long long)g->black,
+                           (unsigned long long)g->red_kings, (unsigned long long)g->black_kings);
+    }
+    else if (strcmp(cmd, "end") == 0) {
+        int s = own_session(c, n > 1 ? tok[1] : NULL);
+        if (s >= 0) { end_session(s); conn_printf(c, "ended %d\n", s); }
+    }
+    else if (strcmp(cmd, "stats") == 0) command_stats(c);
+    else if (strcmp(cmd, "quit") == 0) { c->closing = 1; return; }
+    else conn_printf(c, "error unknown command %s\n", cmd);
+    lat_record(&lat_other, now_ms() - received);
+}
+
+// Everything the socket has for us, one command per complete line. Returns 0 once it's closed
+static int conn_read(Conn *c) {
+    while (1) {
+        ssize_t n = recv(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len, 0);
+        if (n == 0) return 0;
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        c->in_len += (size_t)n;
+
+        size_t start = 0;
+        for (size_t i = 0; i < c->in_len && !c->closing; i++) {
+            if (c->in[i] != '\n') continue;
+            c->in[i] = '\0';
+            run_command(c, c->in + start);
+            start = i + 1;
+        }
+        memmove(c->in, c->in + start, c->in_len - start);
+        c->in_len -= start;
+        if (c->in_len == sizeof(c->in)) { conn_printf(c, "error line too long\n"); c->in_len = 0; }
+        if (c->closing) return 1;
+    }
+}
+
+// Replies the workers finished: play them, tell the owners
+static void collect_replies(void) {
+    char drain[256];
+    while (read(wake_pipe[0], drain, sizeof(drain)) > 0) {}
+
+    while (1) {
+        pthread_mutex_lock(&queue_lock);
+        if (done_count == 0) { pthread_mutex_unlock(&queue_lock); break; }
+        int s = done[done_head];
+        done_head = (done_head + 1) % server_cfg.max_games;
+        done_count--;
+        pthread_mutex_unlock(&queue_lock);
+
+        Session *se = &sessions[s];
+        Job *j = &jobs[s];
+        se->thinking = 0;
+        if (!se->in_use || se->gen != j->gen) { // game ended while the engine was thinking, now nobody's using the slot
+            free_sessions[free_count++] = s;
+            continue;
+        }
+        Conn *c = owner_conn(se);
+        if (!j->has_move) { game_over(c, s); }
+        else {
+            char text[MOVE_TEXT_SIZE];
+            move_to_text(&j->best, text);
+            apply_move(&se->g, &j->best);
+            switch_turn(&se->g);
+            if (c) conn_printf(c, "reply %d %s\n", s, text);
+            game_over(c, s);
+        }
+        lat_record(&lat_moves, now_ms() - j->received);
+        if (c) conn_flush(c);
+    }
+}
+
+// ---------- SERVER ----------
+
+static int open_listener(const ServerConfig *cfg) {
+    int fd;
+    if (cfg->tcp_port) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in a;
+        memset(&a, 0, sizeof(a));
+        a.sin_family = AF_INET;
+        a.sin_port = htons((uint16_t)cfg->tcp_port);
+        a.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // localhost only, there's no authentication
+        if (bind(fd, (struct sockaddr *)&a, sizeof(a)) != 0) { close(fd); return -1; }
+    } else {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        struct sockaddr_un a;
+        memset(&a, 0, sizeof(a));
+        a.sun_family = AF_UNIX;
+        snprintf(a.sun_path, sizeof(a.sun_path), "%s", cfg->unix_path);
+        unlink(cfg->unix_path); // left over from a server that didn't shut down cleanly
+        if (bind(fd, (struct sockaddr *)&a, sizeof(a)) != 0) { close(fd); return -1; }
+    }
+    if (listen(fd, 1024) != 0) { close(fd); return -1; }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// Ask a running server_run() to return. Safe from a signal handler or any thread
+void server_stop(void) {
+    __atomic_store_n(&server_stopping, 1, __ATOMIC_RELEASE);
+    if (__atomic_load_n(&wake_pipe[1], __ATOMIC_ACQUIRE) >= 0) wake_loop();
+}
+
+/**
+ * Serve until server_stop(). Returns 0 after a clean stop, 1 if it couldn't get going
+ * (no memory, socket in use...)
+ */
+int server_run(const ServerConfig *cfg) {
+    server_cfg = *cfg;
+    if (server_cfg.max_games < 1) server_cfg.max_games = SERVER_DEFAULT_GAMES;
+    if (server_cfg.workers < 1) server_cfg.workers = 1;
+    if (server_cfg.workers > MAX_THREADS) server_cfg.workers = MAX_THREADS;
+    int g_max = server_cfg.max_games;
+    sessions = calloc((size_t)g_max, sizeof(Session));
+    jobs = calloc((size_t)g_max, sizeof(Job));
+    free_sessions = malloc((size_t)g_max * sizeof(int));
+    todo = malloc((size_t)g_max * sizeof(int));
+    done = malloc((size_t)g_max * sizeof(int));
+    if (!sessions || !jobs || !free_sessions || !todo || !done) { fprintf(stderr, "Out of memory.\n"); return 1; }
+    for (int s = 0; s < g_max; s++) free_sessions[s] = g_max - 1 - s; // lowest ids first
+    free_count = g_max;
+    todo_head = todo_count = done_head = done_count = 0;
+    memset(&lat_moves, 0, sizeof(lat_moves));
+    memset(&lat_other, 0, sizeof(lat_other));
+    GameState dummy;
+    init_board(&dummy); // sets up the zobrist keys before any worker needs them
+    signal(SIGPIPE, SIG_IGN); // a client hanging up mid-write is an error return, not the end of the server
+
+    listen_fd = open_listener(&server_cfg);
+    if (listen_fd < 0) { perror("server socket"); return 1; }
+    if (wake_pipe[0] < 0) { // kept open for good, so a late server_stop() never writes to a closed (or reused) fd
+        int p[2];
+        if (pipe(p) != 0) { perror("server"); return 1; }
+        fcntl(p[0], F_SETFL, fcntl(p[0], F_GETFL) | O_NONBLOCK);
+        fcntl(p[1], F_SETFL, fcntl(p[1], F_GETFL) | O_NONBLOCK);
+        wake_pipe[0] = p[0];
+        __atomic_store_n(&wake_pipe[1], p[1], __ATOMIC_RELEASE);
+    }
+    if (!ev_init() || !ev_add(listen_fd) || !ev_add(wake_pipe[0])) { perror("server"); return 1; }
+
+    pthread_t ids[MAX_THREADS];
+    int started = 0;
+    workers_quit = 0;
+    for (int w = 0; w < server_cfg.workers; w++, started++)
+        if (pthread_create(&ids[w], NULL, server_worker, NULL) != 0) break;
+    if (started == 0) { fprintf(stderr, "Can't start any workers.\n"); return 1; } // Error catch
+
+    int fds[SERVER_MAX_EVENTS], flags[SERVER_MAX_EVENTS];
+    while (!__atomic_load_n(&server_stopping, __ATOMIC_ACQUIRE)) {
+        int n = ev_wait(fds, flags, SERVER_MAX_EVENTS, 1000);
+        for (int i = 0; i < n; i++) {
+            int fd = fds[i];
+            if (fd == listen_fd) { accept_clients(); continue; }
+            if (fd == wake_pipe[0]) { collect_replies(); continue; }
+            Conn *c = fd < conn_cap ? conns[fd] : NULL;
+            if (!c) continue; // closed earlier in this same batch
+            int open = 1;
+            if (flags[i] & 1) open = conn_read(c);
+            if (open && c->out_len) conn_flush(c);
+            if (!open || (c->closing && c->out_len == 0)) conn_close(c);
+        }
+    }
+
+    pthread_mutex_lock(&queue_lock);
+    workers_quit = 1;
+    pthread_cond_broadcast(&queue_ready);
+    pthread_mutex_unlock(&queue_lock);
+    for (int w = 0; w < started; w++) pthread_join(ids[w], NULL); // searches still running finish first (one reply's time at most)
+
+    for (int fd = 0; fd < conn_cap; fd++) if (conns[fd]) conn_close(conns[fd]);
+    ev_close();
+    close(listen_fd);
+    listen_fd = -1;
+    if (!server_cfg.tcp_port) unlink(server_cfg.unix_path);
+    free(sessions); free(jobs); free(free_sessions); free(todo); free(done); free(conns);
+    conns = NULL;
+    conn_cap = conn_count = active_games = 0;
+    __atomic_store_n(&server_stopping, 0, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// The latency percentiles for people, at the end of a run
+void server_print_stats(FILE *f) {
+    const LatencyHistogram *h[2] = {&lat_moves, &lat_other};
+    const char *names[2] = {"moves (engine replies)", "other commands"};
+    for (int i = 0; i < 2; i++)
+        fprintf(f, "%s: %llu requests, p50 %llu us, p90 %llu us, p99 %llu us, p99.9 %llu us, max %llu us\n", names[i],
+                (unsigned long long)h[i]->total, (unsigned long long)lat_percentile(h[i], 0.5),
+                (unsigned long long)lat_percentile(h[i], 0.9), (unsigned long long)lat_percentile(h[i], 0.99),
+                (unsigned long long)lat_percentile(h[i], 0.999), (unsigned long long)h[i]->max);
+}
+
+#ifndef SERVER_NO_MAIN // test_server.c brings its own main() and clients
+static void on_signal(int sig) { (void)sig; server_stop(); }
+
+int main(int argc, char **argv) {
+    ServerConfig cfg = {SERVER_DEFAULT_SOCKET, 0, (int)sysconf(_SC_NPROCESSORS_ONLN), 16, SERVER_DEFAULT_GAMES, {0, 100, 1}};
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-u") == 0) cfg.unix_path = argv[i + 1];
+        else if (strcmp(argv[i], "-p") == 0) cfg.tcp_port = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-w") == 0) cfg.workers = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-ms") == 0) cfg.limits.time_ms = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-d") == 0) cfg.limits.max_depth = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-mb") == 0) cfg.table_mb = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-g") == 0) cfg.max_games = atoi(argv[i + 1]);
+    }
+    if (cfg.table_mb < 1) cfg.table_mb = 1;
+    if (book_open(BOOK_DEFAULT_FILE)) printf("Opening book loaded (%llu moves).\n", (unsigned long long)book.count);
+    if (tb_open(TB_DEFAULT_FILE)) printf("Endgame tablebase loaded (up to %d pieces).\n", tb.max_pieces);
+#ifdef CHECKERS_NN
+    if (nn_open(NN_DEFAULT_FILE)) printf("Neural network eval loaded (%s).\n", nn_backend_names[nn_backend]); // before any game's board is set up
+#endif
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if (cfg.tcp_port) printf("Listening on 127.0.0.1:%d", cfg.tcp_port);
+    else printf("Listening on %s", cfg.unix_path);
+    printf(" (%s, %d workers, up to %d games)\n", SERVER_EPOLL ? "epoll" : "poll", cfg.workers, cfg.max_games);
+    fflush(stdout);
+    int rc = server_run(&cfg);
+    if (rc == 0) server_print_stats(stdout);
+    return rc;
+}
+#endif
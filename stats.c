@@ -0,0 +1,213 @@
+/**
+ * Instrumentation - counters and cycle timers on the hot paths, for seeing where the time goes and
+ * comparing one build of the engine against another
+ *
+ * Included from checkers.c right after bitops.c, so everything after it can count things
+ *
+ * Compile with -DCHECKERS_STATS to turn it on. Without it every STAT_ macro is ((void)0), so the
+ * normal build doesn't pay for it at all. With it:
+ *   STAT_INC(NODES) / STAT_ADD(CAPTURES, n)         bump a counter
+ *   STAT_TIMER_START(EVAL) ... STAT_TIMER_STOP(EVAL) add the cycles in between (rdtsc) to a timer
+ *
+ * Every thread counts into its own block, so the hot path never touches a cache line another
+ * thread writes and needs no locked instructions. The blocks only get added up when someone asks
+ * (stats_json()). A thread that exits (search helpers do after every search) folds its block into
+ * the totals on the way out
+ *
+ * The numbers come out as one line of JSON: at exit to the file named by $CHECKERS_STATS_FILE
+ * (stderr if it's not set), or any time from the engine protocol's "stats" command
+ */
+#include <pthread.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+enum {
+    STAT_MOVEGEN, STAT_MOVE_PIECE, STAT_APPLY_MOVE, STAT_CAPTURES, STAT_PROMOTIONS,
+    STAT_TT_PROBES, STAT_TT_HITS, STAT_TT_STORES, STAT_TB_PROBES, STAT_TB_HITS,
+    STAT_NODES, STAT_QNODES, STAT_COUNT
+};
+static const char *const stat_names[STAT_COUNT] = {
+    "movegen_calls", "move_piece", "apply_move", "captures", "promotions",
+    "tt_probes", "tt_hits", "tt_stores", "tb_probes", "tb_hits",
+    "nodes", "qnodes"
+};
+
+// Phases with a cycle timer around them (they nest: search includes all the others)
+enum { TIMER_MOVEGEN, TIMER_EVAL, TIMER_TT_PROBE, TIMER_TB_PROBE, TIMER_SEARCH, TIMER_COUNT };
+static const char *const timer_names[TIMER_COUNT] = {"movegen", "eval", "tt_probe", "tb_probe", "search"};
+
+typedef struct StatsBlock {
+    uint64_t counters[STAT_COUNT];
+    uint64_t cycles[TIMER_COUNT];
+    uint64_t calls[TIMER_COUNT];
+    struct StatsBlock *next;    // next live thread's block
+} StatsBlock;
+
+// Cycle counter for the timers (nanoseconds on CPUs without rdtsc)
+static inline uint64_t stats_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#ifdef CHECKERS_STATS
+
+static __thread StatsBlock stats_mine;      // this thread's counters
+static __thread int stats_joined;           // stats_mine is on the live list
+static StatsBlock *stats_live;              // every thread that has counted anything and is still running
+static StatsBlock stats_finished;           // what threads that already exited counted
+static int stats_threads_seen;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t stats_key;             // only there for its destructor, which runs when a thread exits
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static uint64_t stats_start_cycles;         // when counting started, so the dump can say cycles per second
+static double stats_start_seconds;
+
+static double stats_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Relaxed atomics: plain loads/stores on x86, but another thread adding things up mid-search is still allowed
+static inline void stats_bump(uint64_t *p, uint64_t n) { __atomic_store_n(p, __atomic_load_n(p, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED); }
+static inline uint64_t stats_read(const uint64_t *p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+
+static void stats_add_block(StatsBlock *to, const StatsBlock *from) {
+    for (int i = 0; i < STAT_COUNT; i++) to->counters[i] += stats_read(&from->counters[i]);
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        to->cycles[i] += stats_read(&from->cycles[i]);
+        to->calls[i] += stats_read(&from->calls[i]);
+    }
+}
+
+// Thread is exiting: its counts go into stats_finished and its block (about to be freed) off the list
+static void stats_thread_exit(void *arg) {
+    StatsBlock *b = arg;
+    pthread_mutex_lock(&stats_lock);
+    stats_add_block(&stats_finished, b);
+    for (StatsBlock **p = &stats_live; *p; p = &(*p)->next)
+        if (*p == b) { *p = b->next; break; }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+static void stats_setup(void) {
+    pthread_key_create(&stats_key, stats_thread_exit);
+    stats_start_cycles = stats_cycles();
+    stats_start_seconds = stats_seconds();
+}
+
+// First count on this thread - put its block on the live list (once per thread, never on the hot path again)
+static __attribute__((noinline)) void stats_join(void) {
+    pthread_once(&stats_once, stats_setup);
+    pthread_setspecific(stats_key, &stats_mine);
+    pthread_mutex_lock(&stats_lock);
+    stats_mine.next = stats_live;
+    stats_live = &stats_mine;
+    stats_threads_seen++;
+    pthread_mutex_unlock(&stats_lock);
+    stats_joined = 1;
+}
+
+static inline StatsBlock *stats_block(void) {
+    if (__builtin_expect(!stats_joined, 0)) stats_join();
+    return &stats_mine;
+}
+
+static inline void stats_add_time(int timer, uint64_t cycles) {
+    StatsBlock *b = stats_block();
+    stats_bump(&b->cycles[timer], cycles);
+    stats_bump(&b->calls[timer], 1);
+}
+
+#define STAT_ADD(c, n) stats_bump(&stats_block()->counters[STAT_##c], (uint64_t)(n))
+#define STAT_INC(c) STAT_ADD(c, 1)
+#define STAT_TIMER_START(t) uint64_t stat_timer_##t = stats_cycles()
+#define STAT_TIMER_STOP(t) stats_add_time(TIMER_##t, stats_cycles() - stat_timer_##t)
+
+// Everything every thread has counted so far, live and finished
+static void stats_total(StatsBlock *out, int *live_threads) {
+    memset(out, 0, sizeof(*out));
+    *live_threads = 0;
+    pthread_mutex_lock(&stats_lock);
+    stats_add_block(out, &stats_finished);
+    for (StatsBlock *b = stats_live; b; b = b->next) { stats_add_block(out, b); (*live_threads)++; }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+// Start counting from zero again (numbers for one search / one benchmark run)
+void stats_reset(void) {
+    pthread_mutex_lock(&stats_lock);
+    memset(stats_finished.counters, 0, sizeof(stats_finished.counters));
+    memset(stats_finished.cycles, 0, sizeof(stats_finished.cycles));
+    memset(stats_finished.calls, 0, sizeof(stats_finished.calls));
+    for (StatsBlock *b = stats_live; b; b = b->next) {
+        for (int i = 0; i < STAT_COUNT; i++) __atomic_store_n(&b->counters[i], 0, __ATOMIC_RELAXED);
+        for (int i = 0; i < TIMER_COUNT; i++) {
+            __atomic_store_n(&b->cycles[i], 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&b->calls[i], 0, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/**
+ * Everything as one line of JSON into 'buf' (cut off if it doesn't fit, ~1.5 KB is plenty)
+ * Returns the length like snprintf
+ */
+int stats_json(char *buf, size_t size) {
+    StatsBlock t;
+    int live;
+    stats_total(&t, &live);
+    pthread_once(&stats_once, stats_setup);
+    double secs = stats_seconds() - stats_start_seconds;
+    double cycles_per_second = secs > 0 ? (double)(stats_cycles() - stats_start_cycles) / secs : 0;
+
+    size_t n = 0;
+#define STATS_PUT(...) do { int k = snprintf(buf + n, n < size ? size - n : 0, __VA_ARGS__); if (k > 0) n += (size_t)k; } while (0)
+    STATS_PUT("{\"enabled\":true,\"compiler\":\"%s\",\"built\":\"%s %s\",\"seconds\":%.3f,\"cycles_per_second\":%.0f,"
+              "\"threads_seen\":%d,\"threads_live\":%d,\"counters\":{",
+              __VERSION__, __DATE__, __TIME__, secs, cycles_per_second, stats_threads_seen, live);
+    for (int i = 0; i < STAT_COUNT; i++)
+        STATS_PUT("%s\"%s\":%llu", i ? "," : "", stat_names[i], (unsigned long long)t.counters[i]);
+    STATS_PUT("},\"timers\":{");
+    for (int i = 0; i < TIMER_COUNT; i++)
+        STATS_PUT("%s\"%s\":{\"calls\":%llu,\"cycles\":%llu,\"cycles_per_call\":%.1f}", i ? "," : "", timer_names[i],
+                  (unsigned long long)t.calls[i], (unsigned long long)t.cycles[i],
+                  t.calls[i] ? (double)t.cycles[i] / (double)t.calls[i] : 0.0);
+    STATS_PUT("}}");
+#undef STATS_PUT
+    return (int)n;
+}
+
+// The at-exit dump
+static __attribute__((destructor)) void stats_dump_at_exit(void) {
+    char buf[2048];
+    stats_json(buf, sizeof(buf));
+    const char *path = getenv("CHECKERS_STATS_FILE");
+    FILE *f = path && *path ? fopen(path, "w") : stderr;
+    if (!f) f = stderr; // Error catch - can't write the file, still show the numbers
+    fprintf(f, "%s\n", buf);
+    if (f != stderr) fclose(f);
+}
+
+#else // not instrumented - nothing gets counted
+
+#define STAT_ADD(c, n) ((void)0)
+#define STAT_INC(c) ((void)0)
+#define STAT_TIMER_START(t) ((void)0)
+#define STAT_TIMER_STOP(t) ((void)0)
+
+void stats_reset(void) {}
+
+int stats_json(char *buf, size_t size) {
+    return snprintf(buf, size, "{\"enabled\":false}");
+}
+
+#endif // CHECKERS_STATS
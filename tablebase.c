@@ -0,0 +1,205 @@
+/**
+ * Endgame tablebase - the exact result (win/loss/draw and how many moves it takes) of every
+ * position with only a few pieces left, worked out ahead of time by tbgen.c
+ *
+ * Included from checkers.c after movegen.c. This half is the lookup: the file gets mmap'd and
+ * every probe is just some index math and one byte read, nothing gets loaded into the heap
+ *
+ * Indexing - positions are split into "slices" by how many of each piece there are
+ * (red men, red kings, black men, black kings). Inside a slice each piece type is a set of squares,
+ * and a set of k squares out of n has a unique number from 0 to C(n, k) - 1 (combinatorial number
+ * system). The slice index mixes the four set numbers together, times 2 for whose turn it is.
+ * Pieces of different types landing on the same square make a few indexes that can't happen,
+ * that's the price for the index math being this simple
+ *
+ * Red men can never stand on row 7 (they'd be kings) and black men never on row 0, so men only
+ * count the 28 squares they can be on, kings count all 32 dark squares
+ *
+ * Values, from the side to move's point of view:
+ *   0          draw (nobody can force a win)
+ *   1..127     win, in that many plies (half moves)
+ *   128..255   loss, in (value - 128) plies
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TB_MAX_PIECES 8         // most pieces on the board any slice can have
+#define TB_DIM (TB_MAX_PIECES + 1)
+#define TB_RULES_VERSION 2      // bump when the move rules change, old files get rejected (2 = forced captures)
+#define TB_DEFAULT_FILE "checkers.tb"
+
+#define TB_DRAW 0
+#define TB_LOSS_BASE 128
+#define TB_IS_WIN(v)  ((v) >= 1 && (v) < TB_LOSS_BASE)
+#define TB_IS_LOSS(v) ((v) >= TB_LOSS_BASE)
+#define TB_DIST(v)    (TB_IS_LOSS(v) ? (v) - TB_LOSS_BASE : (v))
+#define TB_NOT_FOUND  (-1)
+
+#define RED_MEN_SQUARES    (DARK_SQUARES & ~TOP_ROW)     // 28 squares
+#define BLACK_MEN_SQUARES  (DARK_SQUARES & ~BOTTOM_ROW)  // 28 squares
+
+// File layout: this header, then (TB_DIM)^4 slice offsets (0 = slice not in the file), then the slices
+typedef struct {
+    char magic[8];              // "BBCHKTB"
+    uint32_t rules_version;     // TB_RULES_VERSION of the rules that built it
+    uint32_t max_pieces;        // every slice with this many pieces or fewer is in the file
+} TBHeader;
+
+typedef struct {
+    int max_pieces;                                     // 0 = nothing loaded
+    const uint8_t *slice[TB_DIM][TB_DIM][TB_DIM][TB_DIM];  // [red men][red kings][black men][black kings]
+    void *map;                                          // the mmap'd file (NULL while tbgen is building)
+    size_t map_size;
+} Tablebase;
+
+static Tablebase tb; // the one the game and search probe
+
+static uint64_t binomial[33][TB_DIM]; // binomial[n][k] = C(n, k)
+
+static void init_binomial(void) {
+    if (binomial[0][0]) return;
+    for (int n = 0; n <= 32; n++) {
+        binomial[n][0] = 1;
+        for (int k = 1; k < TB_DIM; k++)
+            binomial[n][k] = n == 0 ? 0 : binomial[n - 1][k - 1] + binomial[n - 1][k];
+    }
+}
+
+/**
+ * Number of a set of squares (already squeezed down to the low bits with pext)
+ * The i-th lowest square at position p adds C(p, i + 1)
+ */
+static uint64_t rank_set(uint64_t compact) {
+    uint64_t r = 0;
+    for (int i = 1; compact; i++) r += binomial[pop_lsb(&compact)][i];
+    return r;
+}
+
+// The opposite of rank_set(): the set of k squares (out of n) with number r
+static uint64_t unrank_set(uint64_t r, int k, int n) {
+    uint64_t compact = 0;
+    for (int i = k, p = n - 1; i >= 1; i--) {
+        while (binomial[p][i] > r) p--; // biggest p with C(p, i) <= r
+        compact |= 1ULL << p;
+        r -= binomial[p][i];
+        p--;
+    }
+    return compact;
+}
+
+// How many indexes a slice has (both turns)
+uint64_t tb_slice_size(int rm, int rk, int bm, int bk) {
+    init_binomial();
+    return binomial[28][rm] * binomial[32][rk] * binomial[28][bm] * binomial[32][bk] * 2;
+}
+
+// Index of 'g' inside its slice
+static uint64_t tb_index(GameState *g, int rk, int bm, int bk) {
+    uint64_t idx = rank_set(pext(g->red, RED_MEN_SQUARES));
+    idx = idx * binomial[32][rk] + rank_set(pext(g->red_kings, DARK_SQUARES));
+    idx = idx * binomial[28][bm] + rank_set(pext(g->black, BLACK_MEN_SQUARES));
+    idx = idx * binomial[32][bk] + rank_set(pext(g->black_kings, DARK_SQUARES));
+    return idx * 2 + (uint64_t)g->turn;
+}
+
+/**
+ * Turn an index back into a position (tbgen walks every index this way)
+ * Returns 0 if two pieces ended up on the same square - that index is never a real position
+ */
+int tb_position(uint64_t idx, int rm, int rk, int bm, int bk, GameState *g) {
+    g->turn = (int)(idx & 1);
+    idx >>= 1;
+    uint64_t bk_rank = idx % binomial[32][bk]; idx /= binomial[32][bk];
+    uint64_t bm_rank = idx % binomial[28][bm]; idx /= binomial[28][bm];
+    uint64_t rk_rank = idx % binomial[32][rk]; idx /= binomial[32][rk];
+
+    g->red = pdep(unrank_set(idx, rm, 28), RED_MEN_SQUARES);
+    g->red_kings = pdep(unrank_set(rk_rank, rk, 32), DARK_SQUARES);
+    g->black = pdep(unrank_set(bm_rank, bm, 28), BLACK_MEN_SQUARES);
+    g->black_kings = pdep(unrank_set(bk_rank, bk, 32), DARK_SQUARES);
+
+    int pieces = rm + rk + bm + bk;
+    if (popcount(g->red | g->red_kings | g->black | g->black_kings) != pieces) return 0;
+    g->hash = compute_hash(g);
+    g->eval = compute_eval(g);
+    NN_REFRESH(g);
+    return 1;
+}
+
+/**
+ * Look a position up in 't'
+ * Returns the value byte, or TB_NOT_FOUND if the table doesn't have that slice
+ * A side with no pieces left has lost, that never needs a table
+ */
+int tb_lookup(const Tablebase *t, GameState *g) {
+    int rm = popcount(g->red), rk = popcount(g->red_kings);
+    int bm = popcount(g->black), bk = popcount(g->black_kings);
+    int mine = g->turn == 0 ? rm + rk : bm + bk;
+    int theirs = g->turn == 0 ? bm + bk : rm + rk;
+    if (mine == 0) return TB_LOSS_BASE; // lost already, no moves
+    if (theirs == 0 || mine + theirs > t->max_pieces) return TB_NOT_FOUND;
+
+    const uint8_t *slice = t->slice[rm][rk][bm][bk];
+    if (!slice) return TB_NOT_FOUND;
+    // relaxed atomic read = a plain byte load, but tbgen's threads are writing this array while they read it
+    return __atomic_load_n(&slice[tb_index(g, rk, bm, bk)], __ATOMIC_RELAXED);
+}
+
+// Probe the loaded table (nothing loaded = TB_NOT_FOUND for everything)
+int tb_probe(GameState *g) {
+    if (!tb.max_pieces) return TB_NOT_FOUND;
+    STAT_INC(TB_PROBES);
+    STAT_TIMER_START(TB_PROBE);
+    int v = tb_lookup(&tb, g);
+    STAT_TIMER_STOP(TB_PROBE);
+    if (v != TB_NOT_FOUND) STAT_INC(TB_HITS);
+    return v;
+}
+
+/**
+ * mmap a table file and point every slice straight into the mapping
+ * Returns the number of pieces it covers, 0 if the file isn't there or isn't a valid table
+ */
+int tb_open(const char *path) {
+    init_binomial();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TBHeader)) { close(fd); return 0; }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping stays alive on its own
+    if (map == MAP_FAILED) return 0;
+
+    const TBHeader *h = map;
+    size_t table_end = sizeof(TBHeader) + sizeof(uint64_t) * TB_DIM * TB_DIM * TB_DIM * TB_DIM;
+    if (memcmp(h->magic, "BBCHKTB", 8) != 0 || h->rules_version != TB_RULES_VERSION ||
+        h->max_pieces < 2 || h->max_pieces > TB_MAX_PIECES || (size_t)st.st_size < table_end) {
+        munmap(map, (size_t)st.st_size); // Error catch - some other file, or built with older rules
+        return 0;
+    }
+    madvise(map, (size_t)st.st_size, MADV_RANDOM); // probes jump all over, don't bother reading ahead
+
+    if (tb.map) munmap(tb.map, tb.map_size);
+    memset(&tb, 0, sizeof(tb));
+    const uint64_t *offsets = (const uint64_t *)(h + 1);
+    for (int rm = 0; rm < TB_DIM; rm++)
+        for (int rk = 0; rk < TB_DIM; rk++)
+            for (int bm = 0; bm < TB_DIM; bm++)
+                for (int bk = 0; bk < TB_DIM; bk++) {
+                    uint64_t off = offsets[((rm * TB_DIM + rk) * TB_DIM + bm) * TB_DIM + bk];
+                    if (off && off + tb_slice_size(rm, rk, bm, bk) <= (uint64_t)st.st_size)
+                        tb.slice[rm][rk][bm][bk] = (const uint8_t *)map + off;
+                }
+    tb.map = map;
+    tb.map_size = (size_t)st.st_size;
+    tb.max_pieces = (int)h->max_pieces;
+    return tb.max_pieces;
+}
+
+// Total pieces on the board, to know if the table could have the position
+static inline int tb_pieces(GameState *g) {
+    return popcount(g->red | g->black | g->red_kings | g->black_kings);
+}
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#define CHECKERS_NO_MAIN // rules + tablebase indexing from checkers.c, our own main()
+#include "checkers.c"
+
+/**
+ * Endgame tablebase generator - works out every position with up to N pieces and writes the
+ * file that tablebase.c mmaps
+ *
+ * Usage: ./tbgen [-n pieces] [-t threads] [-o file]     (defaults: 4 pieces, every core, checkers.tb)
+ *
+ * Retrograde analysis, done in passes:
+ *   pass 0:  anyone with no moves has lost (loss in 0)
+ *   pass p:  a position is a WIN in p if some move leads to a LOSS in p - 1 for the opponent,
+ *            and a LOSS in p if every move leads to a WIN for the opponent and the longest is p - 1
+ *   ...until a pass finds nothing new. Whatever never got solved is a draw
+ * Doing it one distance per pass means the distances come out as the shortest win / longest loss
+ * A value byte only holds distances up to TBGEN_MAX_DIST. If a slice still has positions to solve
+ * past that, tbgen stops with an error instead of writing them down as draws
+ *
+ * Slices depend on each other: a capture leads to a slice with fewer pieces and crowning leads to
+ * one with more kings, so we solve fewest pieces first and, within the same count, most kings first.
+ * Both of those only ever point at slices that are already finished
+ *
+ * Each pass splits the slice into one chunk per thread. A position only ever changes once
+ * (unknown -> solved) and a pass only uses results from earlier passes, so threads can share the
+ * array with plain relaxed atomic byte loads/stores and no locks
+ */
+
+typedef struct {
+    int rm, rk, bm, bk;     // the slice being solved
+    uint8_t *values;        // its values, being filled in
+    uint64_t lo, hi;        // this thread's chunk of indexes
+    int pass;
+    uint64_t changed;       // positions this thread solved in this pass
+} PassJob;
+
+#ifndef TBGEN_MAX_DIST // overridable only to try out the too-deep error on small tables
+#define TBGEN_MAX_DIST (TB_LOSS_BASE - 1) // most plies a value byte holds, win or loss
+#endif
+
+static Tablebase build; // slices built so far (heap memory while generating)
+static int too_deep;    // a slice needed a distance past TBGEN_MAX_DIST
+static uint8_t dist_seen[TB_LOSS_BASE]; // distances that show up anywhere in the finished slices
+
+static inline uint8_t load_value(const uint8_t *p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+static inline void store_value(uint8_t *p, uint8_t v) { __atomic_store_n(p, v, __ATOMIC_RELAXED); }
+
+/**
+ * Solve what can be solved in this pass for one chunk of the slice
+ * Every child either lands in this same slice (read the array we're filling) or in a finished one
+ */
+static void *run_pass(void *arg) {
+    PassJob *job = arg;
+    GameState g;
+    MoveList list;
+    Undo u;
+    int p = job->pass;
+
+    for (uint64_t idx = job->lo; idx < job->hi; idx++) {
+        if (load_value(&job->values[idx]) != TB_DRAW) continue; // already solved
+        if (!tb_position(idx, job->rm, job->rk, job->bm, job->bk, &g)) continue; // pieces overlap, not a real position
+
+        generate_moves(&g, &list);
+        if (list.count == 0) { // stuck = lost, only happens in pass 0
+            if (p == 0) { store_value(&job->values[idx], TB_LOSS_BASE); job->changed++; }
+            continue;
+        }
+        if (p == 0) continue;
+
+        int win = 0, all_wins = 1, longest = 0;
+        for (int i = 0; i < list.count && !win; i++) {
+            make_move(&g, list.moves[i], &u);
+            int v = tb_lookup(&build, &g);
+            unmake_move(&g, &u);
+
+            if (v == TB_NOT_FOUND) { all_wins = 0; continue; } // Error catch - can't happen with the slice order
+            if (TB_IS_LOSS(v) && TB_DIST(v) == p - 1) win = 1;
+            else if (TB_IS_WIN(v)) { if (TB_DIST(v) > longest) longest = TB_DIST(v); }
+            else all_wins = 0;
+        }
+
+        if (p > TBGEN_MAX_DIST) { job->changed += win || (all_wins && longest == p - 1); continue; } // only checking, no room to store it
+        if (win) { store_value(&job->values[idx], (uint8_t)p); job->changed++; }
+        else if (all_wins && longest == p - 1) { store_value(&job->values[idx], (uint8_t)(TB_LOSS_BASE + p)); job->changed++; }
+    }
+    return NULL;
+}
+
+/**
+ * Solve one slice with 'threads' threads
+ * A pass that finds nothing doesn't mean we're done: a capture or crowning into a finished slice
+ * can still hand us a loss/win at a bigger distance. So after an empty pass we skip straight to
+ * the next distance that exists in the finished slices (nothing can happen in between), and stop
+ * once there isn't one
+ * Pass TBGEN_MAX_DIST + 1 only counts: anything it finds can't be stored, so it sets too_deep (nothing
+ * past it can happen either, no stored distance is any bigger)
+ */
+static uint8_t *solve_slice(int rm, int rk, int bm, int bk, int threads) {
+    uint64_t size = tb_slice_size(rm, rk, bm, bk);
+    uint8_t *values = calloc(size, 1);
+    if (!values) return NULL;
+    build.slice[rm][rk][bm][bk] = values; // visible to lookups right away, moves inside the slice read it
+
+    PassJob jobs[256];
+    pthread_t ids[256];
+    int spawned[256]; // 0 = that chunk ran right here, nothing to join
+    for (int p = 0; p <= TBGEN_MAX_DIST + 1; p++) {
+        uint64_t changed = 0;
+        for (int t = 0; t < threads; t++) {
+            jobs[t] = (PassJob){rm, rk, bm, bk, values, size * t / threads, size * (t + 1) / threads, p, 0};
+            spawned[t] = threads > 1 && pthread_create(&ids[t], NULL, run_pass, &jobs[t]) == 0;
+            if (!spawned[t]) run_pass(&jobs[t]); // one thread, or Error catch - no thread, do the chunk ourselves
+        }
+        for (int t = 0; t < threads; t++) {
+            if (spawned[t]) pthread_join(ids[t], NULL);
+            changed += jobs[t].changed;
+        }
+        if (p > TBGEN_MAX_DIST) { too_deep = changed > 0; break; }
+        if (changed || p == 0) continue;
+
+        int next = p; // the loop's p++ makes this p = d + 1 for the next distance d we know about
+        while (next <= TBGEN_MAX_DIST && !dist_seen[next]) next++;
+        if (next > TBGEN_MAX_DIST) break; // nothing deeper to come
+        p = next;
+    }
+
+    for (uint64_t i = 0; i < size; i++) dist_seen[TB_DIST(values[i])] = 1;
+    return values;
+}
+
+int main(int argc, char **argv) {
+    int pieces = 4;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *out = TB_DEFAULT_FILE;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0) pieces = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-t") == 0) threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-o") == 0) out = argv[i + 1];
+    }
+    if (pieces < 2 || pieces > TB_MAX_PIECES) { printf("Pieces must be 2-%d.\n", TB_MAX_PIECES); return 1; }
+    if (threads < 1) threads = 1;
+    if (threads > 256) threads = 256;
+
+    init_zobrist();
+    init_binomial();
+    build.max_pieces = pieces;
+
+    FILE *f = fopen(out, "wb");
+    if (!f) { printf("Can't write %s\n", out); return 1; }
+    TBHeader header = {"BBCHKTB", TB_RULES_VERSION, (uint32_t)pieces};
+    static uint64_t offsets[TB_DIM * TB_DIM * TB_DIM * TB_DIM];
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(offsets, sizeof(offsets), 1, f); // placeholder, real offsets get written at the end
+    uint64_t file_pos = sizeof(header) + sizeof(offsets);
+
+    double start = now_ms() / 1000.0;
+    int deepest = 0;
+    dist_seen[0] = 1; // a side with no pieces is a loss in 0, that's not stored in any slice
+    uint64_t total = 0;
+    printf("Building %d piece tablebase with %d threads\n", pieces, threads);
+
+    // fewest pieces first, then most kings first (see the top of the file)
+    for (int n = 2; n <= pieces; n++) {
+        for (int kings = n; kings >= 0; kings--) {
+            for (int rm = 0; rm <= n; rm++)
+                for (int rk = 0; rm + rk <= n; rk++)
+                    for (int bm = 0; rm + rk + bm <= n; bm++) {
+                        int bk = n - rm - rk - bm;
+                        if (rk + bk != kings || rm + rk == 0 || bm + bk == 0) continue;
+
+                        double t = now_ms() / 1000.0;
+                        uint8_t *values = solve_slice(rm, rk, bm, bk, threads);
+                        if (!values) { printf("Out of memory.\n"); fclose(f); return 1; }
+                        if (too_deep) { // Error catch - the rest would silently come out as draws
+                            printf("%d men %d kings vs %d men %d kings has wins longer than %d plies, more than the "
+                                   "file can hold. Nothing written.\n", rm, rk, bm, bk, TBGEN_MAX_DIST);
+                            fclose(f);
+                            remove(out);
+                            return 1;
+                        }
+                        uint64_t size = tb_slice_size(rm, rk, bm, bk);
+
+                        uint64_t wins = 0, losses = 0;
+                        for (uint64_t i = 0; i < size; i++) {
+                            wins += TB_IS_WIN(values[i]);
+                            losses += TB_IS_LOSS(values[i]);
+                            if (values[i] && TB_DIST(values[i]) > deepest) deepest = TB_DIST(values[i]);
+                        }
+                        printf("  %d men %d kings vs %d men %d kings: %12llu positions, %llu wins, %llu losses (%.2f s)\n",
+                               rm, rk, bm, bk, (unsigned long long)size, (unsigned long long)wins,
+                               (unsigned long long)losses, now_ms() / 1000.0 - t);
+
+                        uint64_t pad = (64 - file_pos % 64) % 64; // each slice starts on a cache line
+                        static const uint8_t zeros[64];
+                        fwrite(zeros, 1, pad, f);
+                        file_pos += pad;
+                        offsets[((rm * TB_DIM + rk) * TB_DIM + bm) * TB_DIM + bk] = file_pos;
+                        fwrite(values, 1, size, f);
+                        file_pos += size;
+                        total += size;
+                    }
+        }
+    }
+
+    fseek(f, sizeof(header), SEEK_SET);
+    fwrite(offsets, sizeof(offsets), 1, f);
+    if (fclose(f) != 0) { printf("Error writing %s\n", out); return 1; }
+
+    printf("Wrote %s: %llu positions, longest win %d plies, %.2f s\n", out, (unsigned long long)total,
+           deepest, now_ms() / 1000.0 - start);
+    return 0;
+}
@@ -1,7 +1,97 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <time.h>
 #include "bitops.c" 
 
+#define BENCH_BOARDS 4096     // random boards each primitive gets run over
+#define BENCH_ROUNDS 2000     // times through the whole array (~8 million calls per primitive)
+
+static uint64_t bench_boards[BENCH_BOARDS];
+static volatile uint64_t bench_sink; // results go here so the compiler can't skip the loops
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Time one backend: popcount, lsb_index, pop_lsb (walking every bit of a board) and pext/pdep
+ * against the dark squares, reported as nanoseconds per call
+ */
+static void bench_backend(void) {
+    const uint64_t dark = 0x55AA55AA55AA55AAULL;
+    double calls = (double)BENCH_BOARDS * BENCH_ROUNDS;
+    uint64_t acc = 0;
+
+    double t = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+        for (int i = 0; i < BENCH_BOARDS; i++) acc += bitops.popcount(bench_boards[i]);
+    printf("  popcount   %6.2f ns/op\n", (now_ns() - t) / calls);
+
+    t = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+        for (int i = 0; i < BENCH_BOARDS; i++) acc += bitops.lsb_index(bench_boards[i] | 1ULL << 63);
+    printf("  lsb_index  %6.2f ns/op\n", (now_ns() - t) / calls);
+
+    uint64_t bits = 0;
+    t = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS / 8; r++)
+        for (int i = 0; i < BENCH_BOARDS; i++) {
+            uint64_t b = bench_boards[i];
+            while (b) { acc += bitops.lsb_index(b); b &= b - 1; bits++; } // same walk as pop_lsb
+        }
+    printf("  pop_lsb    %6.2f ns/bit\n", (now_ns() - t) / (double)bits);
+
+    t = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+        for (int i = 0; i < BENCH_BOARDS; i++) acc += bitops.pext(bench_boards[i], dark);
+    printf("  pext       %6.2f ns/op\n", (now_ns() - t) / calls);
+
+    t = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+        for (int i = 0; i < BENCH_BOARDS; i++) acc += bitops.pdep(bench_boards[i], dark);
+    printf("  pdep       %6.2f ns/op\n", (now_ns() - t) / calls);
+
+    bench_sink = acc;
+}
+
+/**
+ * Make sure the hardware versions give the exact same answers as the portable ones, then time both
+ * Returns how many answers didn't match
+ */
+static int test_backends(void) {
+    uint64_t seed = 12345;
+    for (int i = 0; i < BENCH_BOARDS; i++) { // xorshift64 - good enough random boards
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        bench_boards[i] = seed & (seed >> 3); // sparser than 50/50, more like a real board
+    }
+
+    int errors = 0;
+    if (set_bitops_backend(BITOPS_HARDWARE)) {
+        for (int i = 0; i < BENCH_BOARDS; i++) {
+            uint64_t b = bench_boards[i] | 1; // lsb_index needs a nonzero board
+            uint64_t m = bench_boards[(i + 1) % BENCH_BOARDS];
+            if (bitops.popcount(b) != popcount_portable(b)) errors++;
+            if (bitops.lsb_index(b) != lsb_index_portable(b)) errors++;
+            if (bitops.pext(b, m) != pext_portable(b, m)) errors++;
+            if (bitops.pdep(b, m) != pdep_portable(b, m)) errors++;
+        }
+        printf("\nHardware vs portable mismatches: %d\n", errors);
+    } else {
+        printf("\nNo POPCNT/BMI on this CPU, only the portable backend to test\n");
+    }
+
+    int backends[2] = {BITOPS_PORTABLE, BITOPS_HARDWARE};
+    for (int i = 0; i < 2; i++) {
+        if (!set_bitops_backend(backends[i])) continue;
+        printf("\nBackend: %s\n", bitops.name);
+        bench_backend();
+    }
+    set_bitops_backend(BITOPS_HARDWARE); // back to the best one
+    return errors;
+}
+
 int main() {
     uint64_t board = 0;
 
@@ -98,6 +188,24 @@ int main() {
     board = shift_bit(board, 0, 1);
     printf("\nAfter attempting to shift bit 0 right (should stay at 0):\n");
     print_board(board);
+
+    // --- Test PopLsb ---
+    board = 0;
+    board = set_bit(board, 9);
+    board = set_bit(board, 40);
+    printf("\nWalking bits 9 and 40 with pop_lsb:");
+    while (board) printf(" %d", pop_lsb(&board));
+    printf("\n");
+
+    // --- Test Pext/Pdep ---
+    board = 0x00000000000000AAULL; // the dark squares on row 0
+    printf("pext of row 0 dark squares: %llu (should be 15)\n",
+           (unsigned long long)pext(board, 0x55AA55AA55AA55AAULL));
+    printf("pdep back out: ");
+    print_hex(pdep(15, 0x55AA55AA55AA55AAULL));
+
+    // --- Backends + microbenchmark ---
+    int errors = test_backends();
     
-    return 0;
+    return errors ? 1 : 0;
 }
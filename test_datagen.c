@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#define DATAGEN_NO_MAIN // the generator, without its main()
+#include "datagen.c"
+
+/**
+ * Tests for datagen.c - small runs into /tmp, every file read back with zlib
+ *
+ * Records: every one a valid position with a score and a result, no capture pending for the side to
+ * move, no known win, and as many of them as the run said it wrote
+ * Resuming: delete two files (one with a half written .tmp left next to it), run again with a
+ * different number of workers - only those two get played again, and they come out the same
+ * Stopping: datagen_stop() part way through leaves only complete files (no .tmp), and running again
+ * finishes the rest
+ */
+
+#define TEST_PREFIX "/tmp/checkers_test_datagen"
+#define TEST_GAMES 24
+#define TEST_SHARD_GAMES 6
+#define TEST_STOP_GAMES 1200
+
+// Whole file decompressed into *out (malloc'd), returns its size or -1
+static long read_shard(int index, char **out) {
+    char name[1024];
+    shard_name(name, sizeof(name), index, 0);
+    gzFile f = gzopen(name, "rb");
+    if (!f) return -1;
+    size_t cap = 1 << 16, len = 0;
+    char *buf = malloc(cap);
+    int n;
+    while (buf && (n = gzread(f, buf + len, (unsigned)(cap - len))) > 0) {
+        len += (size_t)n;
+        if (len == cap) { cap *= 2; buf = realloc(buf, cap); }
+    }
+    gzclose(f);
+    *out = buf;
+    return buf ? (long)len : -1;
+}
+
+// Check one file's records, adds them to *count. Returns the number of bad ones (a bad file = 1)
+static int check_shard(int index, uint64_t *count) {
+    char *data;
+    long len = read_shard(index, &data);
+    if (len < (long)sizeof(RecordHeader)) { if (len >= 0) free(data); return 1; }
+    const RecordHeader *h = (const RecordHeader *)data;
+    int bad = memcmp(h->magic, "BBCHKPOS", 8) != 0 || h->record_size != sizeof(PackedPosition) ||
+              (len - (long)sizeof(RecordHeader)) % (long)sizeof(PackedPosition) != 0;
+    const PackedPosition *p = (const PackedPosition *)(h + 1);
+    long n = (len - (long)sizeof(RecordHeader)) / (long)sizeof(PackedPosition);
+    for (long i = 0; i < n && !bad; i++) {
+        GameState g;
+        unpack_position(&p[i], &g);
+        MoveList list;
+        generate_moves(&g, &list);
+        if (!record_valid(&p[i]) || !(p[i].flags & RECORD_HAS_SCORE) || !(p[i].flags & RECORD_HAS_RESULT) ||
+            list.count == 0 || list.moves[0].captures || abs(p[i].score) > WIN_SCORE - WIN_RANGE) bad++;
+    }
+    *count += (uint64_t)n;
+    free(data);
+    return bad;
+}
+
+static int shards_of(int games) { return (games + TEST_SHARD_GAMES - 1) / TEST_SHARD_GAMES; }
+
+static int tmp_files_left(int games) {
+    int left = 0;
+    for (int k = 0; k < shards_of(games); k++) {
+        char name[1024];
+        shard_name(name, sizeof(name), k, 1);
+        left += access(name, F_OK) == 0;
+    }
+    return left;
+}
+
+static void remove_all(int games) {
+    for (int k = 0; k < shards_of(games); k++) {
+        char name[1024];
+        shard_name(name, sizeof(name), k, 0);
+        remove(name);
+        shard_name(name, sizeof(name), k, 1);
+        remove(name);
+    }
+}
+
+static void *stop_soon(void *arg) {
+    (void)arg;
+    usleep(200000);
+    datagen_stop();
+    return NULL;
+}
+
+int main() {
+    DatagenConfig cfg = {TEST_PREFIX, TEST_GAMES, 2, TEST_SHARD_GAMES, 4, 2, 4, 6, 7, {3, 0, 1}};
+    DatagenStats st;
+    remove_all(TEST_GAMES);
+
+    // --- Full run ---
+    if (!datagen_run(&cfg, &st)) { printf("Couldn't start.\n"); return 1; }
+    uint64_t count = 0;
+    int record_bad = 0;
+    for (int k = 0; k < shards_of(TEST_GAMES); k++) record_bad += check_shard(k, &count);
+    int run_ok = !st.stopped && st.games_played == TEST_GAMES && st.shards_written == shards_of(TEST_GAMES) &&
+                 count == st.positions && count > 0 && !tmp_files_left(TEST_GAMES);
+    printf("Run: %d games, %llu positions in %d files, %d bad records, %s\n", st.games_played,
+           (unsigned long long)count, st.shards_written, record_bad, run_ok ? "ok" : "WRONG");
+
+    // --- Resume ---
+    char *before[2], *after[2];
+    long before_len[2], after_len[2];
+    int redo[2] = {1, 3};
+    for (int i = 0; i < 2; i++) {
+        before_len[i] = read_shard(redo[i], &before[i]);
+        char name[1024];
+        shard_name(name, sizeof(name), redo[i], 0);
+        remove(name);
+    }
+    char tmp[1024];
+    shard_name(tmp, sizeof(tmp), 3, 1);
+    FILE *junk = fopen(tmp, "wb"); // what a run killed in the middle of writing leaves behind
+    if (junk) { fputs("half a file", junk); fclose(junk); }
+    cfg.workers = 1;
+    datagen_run(&cfg, &st);
+    int resume_ok = !st.stopped && st.shards_skipped == shards_of(TEST_GAMES) - 2 && st.shards_written == 2 &&
+                    st.games_played == 2 * TEST_SHARD_GAMES && !tmp_files_left(TEST_GAMES);
+    for (int i = 0; i < 2; i++) {
+        after_len[i] = read_shard(redo[i], &after[i]);
+        resume_ok &= before_len[i] > 0 && before_len[i] == after_len[i] && memcmp(before[i], after[i], (size_t)before_len[i]) == 0;
+        if (before_len[i] >= 0) free(before[i]);
+        if (after_len[i] >= 0) free(after[i]);
+    }
+    printf("Resume: %d files skipped, %d written again, %s\n", st.shards_skipped, st.shards_written,
+           resume_ok ? "same as before" : "WRONG");
+    remove_all(TEST_GAMES);
+
+    // --- Stop part way, then finish ---
+    cfg.games = TEST_STOP_GAMES;
+    cfg.workers = 2;
+    remove_all(TEST_STOP_GAMES);
+    pthread_t stopper;
+    pthread_create(&stopper, NULL, stop_soon, NULL);
+    datagen_run(&cfg, &st);
+    pthread_join(stopper, NULL);
+    int first_written = st.shards_written;
+    int stop_ok = st.stopped && first_written < shards_of(TEST_STOP_GAMES) && !tmp_files_left(TEST_STOP_GAMES);
+    datagen_run(&cfg, &st);
+    count = 0;
+    int stop_bad = 0;
+    for (int k = 0; k < shards_of(TEST_STOP_GAMES); k++) stop_bad += check_shard(k, &count);
+    stop_ok &= !st.stopped && st.shards_skipped == first_written &&
+               first_written + st.shards_written == shards_of(TEST_STOP_GAMES) && stop_bad == 0;
+    printf("Stop and carry on: %d files, then the other %d, %s\n", first_written, st.shards_written, stop_ok ? "ok" : "WRONG");
+    remove_all(TEST_STOP_GAMES);
+
+    int failures = record_bad + !run_ok + !resume_ok + !stop_ok;
+    printf("\n%s\n", failures ? "DATAGEN TESTS FAILED" : "All datagen tests passed");
+    return failures ? 1 : 0;
+}
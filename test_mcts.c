@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#define CHECKERS_NO_MAIN // rules + MCTS out of checkers.c
+#include "checkers.c"
+
+/**
+ * Tests for mcts.c
+ *
+ * Playouts: every random move a playout makes (masks and pdep, no move list) has to be one of the
+ * moves generate_moves() gives for that position, and leave the same boards as apply_move() - a
+ * few hundred random games' worth, multi-jumps and crowning included, for both copies of the playout
+ * Search: it has to play a legal move, see a won position as won, and keep going with a pool way
+ * too small for the tree (stops growing instead of running off the end)
+ */
+
+#define TEST_GAMES 500
+#define TEST_MAX_PLIES 200
+
+// Play one playout_step() on 'g' and check it against generate_moves(). Returns 0 = no moves, 1 = ok, -1 = bad
+// hw = 1 checks the POPCNT/BMI2 copy (the one mcts_playout() runs on CPUs that have them)
+static int check_playout_step(GameState *g, uint64_t *rng, int hw) {
+    PlayoutBoard b = {{g->red, g->black}, {g->red_kings, g->black_kings}};
+    int s = g->turn;
+    uint64_t mine = b.men[s] | b.kings[s];
+    uint64_t captured;
+    int last;
+    MoveList list;
+    generate_moves(g, &list);
+#if PLAYOUT_HW
+    int moved = hw ? playout_step_hw(&b, s, rng, &captured, &last) : playout_step_portable(&b, s, rng, &captured, &last);
+#else
+    (void)hw; // no other copy on this CPU family
+    int moved = playout_step_portable(&b, s, rng, &captured, &last);
+#endif
+    if (!moved) return list.count == 0 ? 0 : -1;
+
+    uint64_t left = mine & ~(b.men[s] | b.kings[s]); // the square the piece left (none if a king jumped back home)
+    int from = left ? lsb_index(left) : last;
+    for (int i = 0; i < list.count; i++) {
+        Move *m = &list.moves[i];
+        if (m->from != from || m->to != last || m->captures != captured) continue;
+        apply_move(g, m);
+        switch_turn(g);
+        return g->red == b.men[0] && g->black == b.men[1] && g->red_kings == b.kings[0] && g->black_kings == b.kings[1] ? 1 : -1;
+    }
+    return -1;
+}
+
+int main() {
+    uint64_t rng = 12345;
+    int moves = 0, bad = 0;
+
+    // --- Playout moves vs generate_moves(), portable copy and (if this CPU runs it) the POPCNT/BMI2 one ---
+    for (int hw = 0; hw <= playout_hw; hw++) {
+        int checked = 0, wrong = 0;
+        for (int game = 0; game < TEST_GAMES; game++) {
+            GameState g;
+            init_board(&g);
+            for (int ply = 0; ply < TEST_MAX_PLIES; ply++) {
+                int r = check_playout_step(&g, &rng, hw);
+                if (r == 0) break;
+                checked++;
+                if (r < 0) { wrong++; break; }
+            }
+        }
+        printf("Playout moves (%s): %d checked, %d not legal\n", hw ? "popcnt/bmi2" : "portable", checked, wrong);
+        moves += checked;
+        bad += wrong;
+    }
+    if (!playout_hw) printf("Playout moves (popcnt/bmi2): not checked, this CPU doesn't have them\n");
+
+    // --- Search ---
+    MctsTree tree;
+    if (!mcts_alloc(&tree, 16)) { printf("Out of memory.\n"); return 1; }
+    GameState g;
+    init_board(&g);
+    MctsLimits limits = {20000, 0, 2};
+    MctsResult r = mcts_search(&tree, &g, limits);
+    MoveList list;
+    generate_moves(&g, &list);
+    int legal = 0;
+    for (int i = 0; i < list.count; i++) legal |= same_move(&list.moves[i], &r.best);
+    printf("Start position: %llu playouts in %.3f s (%.0f/s), %d nodes, move %s\n", (unsigned long long)r.playouts,
+           r.seconds, r.seconds > 0 ? r.playouts / r.seconds : 0.0, r.tree_nodes, legal ? "legal" : "NOT LEGAL");
+
+    GameState won = {0}; // red man on 19 takes black's last piece on 28
+    won.red = 1ULL << 19;
+    won.black = 1ULL << 28;
+    won.hash = compute_hash(&won);
+    won.eval = compute_eval(&won);
+    NN_REFRESH(&won);
+    r = mcts_search(&tree, &won, limits);
+    int won_ok = r.has_move && r.best.captures == 1ULL << 28 && r.win_rate > 0.99;
+    printf("Won position: win rate %.3f, %s\n", r.win_rate, won_ok ? "ok" : "WRONG");
+    mcts_free(&tree);
+
+    MctsTree small;
+    if (!mcts_alloc(&small, 1)) { printf("Out of memory.\n"); return 1; }
+    MctsLimits many = {200000, 0, 2};
+    r = mcts_search(&small, &g, many);
+    int full_ok = r.has_move && r.playouts >= 200000 && r.tree_nodes <= small.capacity;
+    printf("Tiny pool: %d of %d nodes, %llu playouts, %s\n", r.tree_nodes, small.capacity,
+           (unsigned long long)r.playouts, full_ok ? "ok" : "WRONG");
+    mcts_free(&small);
+
+    int failures = bad + !legal + !won_ok + !full_ok;
+    printf("\n%s\n", failures ? "MCTS TESTS FAILED" : "All MCTS tests passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#define CHECKERS_NO_MAIN // rules + net out of checkers.c
+#ifndef CHECKERS_NN // also fine built with -DCHECKERS_NN
+#define CHECKERS_NN
+#endif
+#include "checkers.c"
+
+/**
+ * Tests for nn.c - the accumulator every move keeps up to date has to be exactly what a full
+ * recompute from the boards gives, after make_move() and after unmake_move(), and the AVX2 kernels
+ * have to give exactly the scalar numbers
+ *
+ * Weights: random, written with nn_save() and read back with nn_open() like a real weights file
+ * Positions: random legal games from init_board() (jumps, multi-jumps and crowning included),
+ * every game taken back move by move at the end
+ */
+
+#define TEST_FILE "test_nn.bin"
+#define TEST_GAMES 300
+#define TEST_MAX_PLIES 150
+
+static int rand_range(uint64_t *rng, int lo, int hi) { return lo + (int)(splitmix64(rng) % (uint64_t)(hi - lo + 1)); }
+
+// Small enough that no accumulator can overflow int16 (at most 24 pieces x 64 + 96)
+static void random_weights(NNWeights *w, uint64_t *rng) {
+    for (int f = 0; f < NN_INPUTS; f++)
+        for (int i = 0; i < NN_HIDDEN; i++) w->w1[f][i] = (int16_t)rand_range(rng, -64, 64);
+    for (int i = 0; i < NN_HIDDEN; i++) w->b1[i] = (int16_t)rand_range(rng, -32, 96);
+    for (int j = 0; j < NN_L2; j++) {
+        for (int i = 0; i < NN_HIDDEN; i++) w->w2[j][i] = (int8_t)rand_range(rng, -127, 127);
+        w->b2[j] = rand_range(rng, -2000, 2000);
+    }
+    for (int j = 0; j < NN_L2; j++) w->w3[j] = (int8_t)rand_range(rng, -127, 127);
+    w->b3 = rand_range(rng, -500, 500);
+}
+
+static int accumulator_ok(GameState *g) {
+    int16_t full[NN_HIDDEN];
+    nn_refresh(full, g->red, g->black, g->red_kings, g->black_kings);
+    return memcmp(full, g->nn_acc, sizeof(full)) == 0;
+}
+
+// Scalar and AVX2 forward pass on the same accumulator (just the scalar one twice on CPUs without AVX2)
+static int backends_agree(GameState *g) {
+    int was = nn_backend;
+    set_nn_backend(NN_SCALAR);
+    int scalar = nn_forward(g->nn_acc);
+    set_nn_backend(NN_AVX2);
+    int avx2 = nn_forward(g->nn_acc);
+    set_nn_backend(was);
+    return avx2 == scalar;
+}
+
+int main() {
+    static NNWeights w;
+    uint64_t rng = 12345;
+    random_weights(&w, &rng);
+
+    // --- Weights file round trip ---
+    if (!nn_save(TEST_FILE, &w)) { printf("Can't write %s\n", TEST_FILE); return 1; }
+    int load_ok = nn_open(TEST_FILE) && memcmp(&nn_net, &w, sizeof(w)) == 0;
+    printf("Weights file round trip: %s\n", load_ok ? "ok" : "FAILED");
+
+    FILE *f = fopen(TEST_FILE, "r+b"); // a net of the wrong size shouldn't load
+    NNHeader h;
+    int reject_ok = 0;
+    if (f && fread(&h, sizeof(h), 1, f) == 1) {
+        h.hidden++;
+        rewind(f);
+        fwrite(&h, sizeof(h), 1, f);
+        fclose(f);
+        reject_ok = !nn_open(TEST_FILE) && nn_loaded;
+    }
+    printf("Wrong size net rejected: %s\n", reject_ok ? "yes" : "NO");
+    remove(TEST_FILE);
+
+    // --- Incremental accumulator vs full recompute, both backends ---
+    int positions = 0, acc_failures = 0, forward_failures = 0, eval_failures = 0;
+    for (int game = 0; game < TEST_GAMES; game++) {
+        set_nn_backend(game % 2 ? NN_AVX2 : NN_SCALAR); // the accumulator updates go through both too
+        GameState g;
+        init_board(&g);
+        GameState start = g;
+        static Undo undo[TEST_MAX_PLIES];
+        int plies = 0;
+        for (; plies < TEST_MAX_PLIES; plies++) {
+            MoveList list;
+            generate_moves(&g, &list);
+            if (list.count == 0) break;
+            make_move(&g, list.moves[rand_range(&rng, 0, list.count - 1)], &undo[plies]);
+            positions++;
+            if (!accumulator_ok(&g)) acc_failures++;
+            if (!backends_agree(&g)) forward_failures++;
+            int red_score = nn_forward(g.nn_acc);
+            if (red_score > NN_MAX_SCORE) red_score = NN_MAX_SCORE;
+            if (red_score < -NN_MAX_SCORE) red_score = -NN_MAX_SCORE;
+            if (evaluate(&g) != (g.turn == 0 ? red_score : -red_score)) eval_failures++;
+        }
+        while (plies > 0) {
+            unmake_move(&g, &undo[--plies]);
+            if (!accumulator_ok(&g)) acc_failures++;
+        }
+        if (memcmp(start.nn_acc, g.nn_acc, sizeof(g.nn_acc)) != 0) acc_failures++;
+    }
+    printf("Accumulator: %d positions, %d failures\n", positions, acc_failures);
+    printf("Scalar vs AVX2 forward: %d failures\n", forward_failures);
+    printf("evaluate() uses the net: %d failures\n", eval_failures);
+
+    int failures = !load_ok + !reject_ok + acc_failures + forward_failures + eval_failures;
+    printf("\n%s\n", failures ? "NN TESTS FAILED" : "All NN tests passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#define CHECKERS_NO_MAIN // rules + notation out of checkers.c
+#include "checkers.c"
+
+/**
+ * Tests for move notation (movegen.c) - every legal move printed with move_to_text() has to parse
+ * back with parse_move() to that exact move, and no two legal moves in a position can print the same
+ *
+ * Positions: random legal games from init_board() (multi-jumps and crowning included), plus one where
+ * two different double jumps start and end on the same squares
+ */
+
+#define TEST_GAMES 500
+#define TEST_MAX_PLIES 200
+
+// Every move in 'g' round trips and prints differently from the others. Returns the failures
+static int check_position(GameState *g) {
+    MoveList list;
+    generate_moves(g, &list);
+    char text[MAX_MOVES][MOVE_TEXT_SIZE];
+    int failures = 0;
+    for (int i = 0; i < list.count; i++) {
+        move_to_text(&list.moves[i], text[i]);
+        Move back;
+        if (!parse_move(g, text[i], &back) || !same_move(&back, &list.moves[i])) failures++;
+        for (int j = 0; j < i; j++)
+            if (strcmp(text[i], text[j]) == 0) failures++;
+    }
+    return failures;
+}
+
+int main() {
+    uint64_t rng = 12345;
+    int positions = 0, failures = 0;
+    for (int game = 0; game < TEST_GAMES; game++) {
+        GameState g;
+        init_board(&g);
+        for (int ply = 0; ply < TEST_MAX_PLIES; ply++) {
+            positions++;
+            failures += check_position(&g);
+            MoveList list;
+            generate_moves(&g, &list);
+            if (list.count == 0) break;
+            apply_move(&g, &list.moves[splitmix64(&rng) % (uint64_t)list.count]);
+            switch_turn(&g);
+        }
+    }
+    printf("Random games: %d positions, %d failures\n", positions, failures);
+
+    // Red man on 10 can land on 19 or 17 on the way, and ends on 26 either way
+    GameState g = {0};
+    g.red = 0x0000000000080000ULL;
+    g.black = 0x0000140014000000ULL;
+    g.hash = compute_hash(&g);
+    g.eval = compute_eval(&g);
+    NN_REFRESH(&g);
+    MoveList list;
+    generate_moves(&g, &list);
+    char a[MOVE_TEXT_SIZE] = "", b[MOVE_TEXT_SIZE] = "";
+    if (list.count == 2) { move_to_text(&list.moves[0], a); move_to_text(&list.moves[1], b); }
+    int same_ends_ok = list.count == 2 && check_position(&g) == 0;
+    printf("Two jumps, same start and end: %s and %s, %s\n", a, b, same_ends_ok ? "ok" : "WRONG");
+
+    failures += !same_ends_ok;
+    printf("\n%s\n", failures ? "NOTATION TESTS FAILED" : "All notation tests passed");
+    return failures ? 1 : 0;
+}
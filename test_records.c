@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#define CHECKERS_NO_MAIN // rules + records out of checkers.c
+#include "checkers.c"
+
+/**
+ * Round trip tests for records.c - positions packed, written to a file, mmap'd back and unpacked
+ * have to come out exactly the same (boards, turn, hash, score and result)
+ *
+ * Positions: init_board() and everything reached from it by playing random legal moves with
+ * move_piece() (jumps continued, crowning included), a few games' worth
+ */
+
+#define TEST_FILE "test_records.bin"
+#define TEST_GAMES 200
+#define TEST_MAX_PLIES 150
+
+static int same_position(GameState *a, GameState *b) {
+    return a->red == b->red && a->black == b->black && a->red_kings == b->red_kings &&
+           a->black_kings == b->black_kings && a->turn == b->turn && a->hash == b->hash;
+}
+
+// Play one random legal move the way a player would, square by square through move_piece()
+static int random_move(GameState *g, uint64_t *rng) {
+    int moves[256][2], count = 0;
+    for (int from = 0; from < 64; from++)
+        for (int to = 0; to < 64; to++)
+            if (count < 256 && valid_move(g, from, to)) { moves[count][0] = from; moves[count][1] = to; count++; }
+    if (count == 0) return 0;
+
+    int pick = (int)(splitmix64(rng) % (uint64_t)count);
+    int from = moves[pick][0], to = moves[pick][1];
+    int was_capture = abs(to - from) == 14 || abs(to - from) == 18;
+    move_piece(g, from, to);
+    while (was_capture && can_capture_again(g, to)) { // keep jumping like play_game() makes you
+        int next = -1;
+        for (int sq = 0; sq < 64 && next < 0; sq++)
+            if (is_capture_move_valid(g, to, sq)) next = sq;
+        if (next < 0) break;
+        move_piece(g, to, next);
+        to = next;
+    }
+    switch_turn(g);
+    return 1;
+}
+
+int main() {
+    static GameState positions[TEST_GAMES * (TEST_MAX_PLIES + 1)];
+    int count = 0, failures = 0;
+    uint64_t rng = 12345;
+
+    // --- Pack/unpack in memory ---
+    for (int game = 0; game < TEST_GAMES; game++) {
+        GameState g;
+        init_board(&g);
+        positions[count++] = g;
+        for (int ply = 0; ply < TEST_MAX_PLIES && random_move(&g, &rng); ply++) positions[count++] = g;
+    }
+    for (int i = 0; i < count; i++) {
+        PackedPosition p = pack_position(&positions[i], 0, 0);
+        GameState back;
+        unpack_position(&p, &back);
+        if (!same_position(&positions[i], &back) || !record_valid(&p)) failures++;
+    }
+    printf("Pack/unpack: %d positions, %d failures\n", count, failures);
+
+    // --- Write a file, mmap it back ---
+    RecordWriter w;
+    if (!record_writer_open(&w, TEST_FILE)) { printf("Can't write %s\n", TEST_FILE); return 1; }
+    for (int i = 0; i < count; i++) {
+        PackedPosition p = pack_position(&positions[i], i % 3 != 0, i % 3 ? (i % 2001) - 1000 : 0); // every 3rd has no score
+        if (i % 4) record_set_result(&p, i % 4 - 2); // every 4th has no result, the rest black won / draw / red won
+        record_write(&w, &p);
+    }
+    if (!record_writer_close(&w)) { printf("Error writing %s\n", TEST_FILE); return 1; }
+
+    RecordFile rf;
+    if (!record_file_open(TEST_FILE, &rf)) { printf("Can't read %s back\n", TEST_FILE); return 1; }
+    int file_failures = rf.count == (uint64_t)count ? 0 : 1;
+    for (uint64_t i = 0; i < rf.count && i < (uint64_t)count; i++) {
+        const PackedPosition *p = &rf.records[i]; // straight out of the mapping
+        GameState back;
+        unpack_position(p, &back);
+        int has_score = (p->flags & RECORD_HAS_SCORE) != 0;
+        int score_ok = i % 3 ? has_score && p->score == (int)(i % 2001) - 1000 : !has_score && p->score == 0;
+        int has_result = (p->flags & RECORD_HAS_RESULT) != 0;
+        int result_ok = i % 4 ? has_result && record_result(p) == (int)(i % 4) - 2 : !has_result;
+        if (!same_position(&positions[i], &back) || !score_ok || !result_ok || !record_valid(p)) file_failures++;
+    }
+    printf("File round trip: %llu records (%llu bytes each), %d failures\n", (unsigned long long)rf.count,
+           (unsigned long long)sizeof(PackedPosition), file_failures);
+    record_file_close(&rf);
+    remove(TEST_FILE);
+
+    // --- Garbage shouldn't pass as a position ---
+    PackedPosition bad = pack_position(&positions[0], 0, 0);
+    bad.kings |= 1u << 16; // king on an empty square (row 4 is empty at the start)
+    PackedPosition both = pack_position(&positions[0], 0, 0);
+    both.flags |= RECORD_HAS_RESULT | RECORD_RED_WON | RECORD_BLACK_WON; // everybody won
+    int reject_ok = !record_valid(&bad) && !record_valid(&both);
+    printf("Invalid record rejected: %s\n", reject_ok ? "yes" : "NO");
+
+    failures += file_failures + !reject_ok;
+    printf("\n%s\n", failures ? "RECORD TESTS FAILED" : "All record tests passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,311 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#define SERVER_NO_MAIN // the server, without its main()
+#include "server.c"
+
+/**
+ * Tests for server.c - a real server on a Unix socket in /tmp, and a bunch of client threads each
+ * playing a bunch of games at once over one connection, random legal moves at depth 2
+ *
+ * Every client keeps its own copy of every game, so every engine reply has to be legal there, and
+ * "over" can only come when the side to move really has no moves. An illegal move has to get an
+ * error and leave the game alone, and the stats line has to add up at the end. Games ended or dropped
+ * while a reply is pending can't leak that reply into the next game
+ * Latency histogram: percentiles checked against a sorted list of the same numbers
+ */
+
+#define TEST_SOCKET "/tmp/checkers_test_server.sock"
+#define TEST_CLIENTS 8
+#define TEST_GAMES_EACH 16
+#define TEST_MAX_PLIES 120
+
+typedef struct {
+    GameState g;
+    int id, human, plies, waiting, finished;
+} ClientGame;
+
+typedef struct {
+    int fd;
+    char buf[65536];
+    size_t len;
+    uint64_t rng;
+    int games, replies, overs, bad;
+} Client;
+
+// Next whole line from the server (blocking), 0 if it hung up
+static int client_line(Client *c, char *line, size_t size) {
+    while (1) {
+        char *nl = memchr(c->buf, '\n', c->len);
+        if (nl) {
+            size_t n = (size_t)(nl - c->buf);
+            snprintf(line, size, "%.*s", (int)n, c->buf);
+            memmove(c->buf, nl + 1, c->len - n - 1);
+            c->len -= n + 1;
+            return 1;
+        }
+        ssize_t r = recv(c->fd, c->buf + c->len, sizeof(c->buf) - c->len, 0);
+        if (r <= 0) return 0;
+        c->len += (size_t)r;
+    }
+}
+
+static void client_send(Client *c, const char *text) {
+    size_t len = strlen(text), sent = 0;
+    while (sent < len) {
+        ssize_t n = send(c->fd, text + sent, len - sent, 0);
+        if (n <= 0) return;
+        sent += (size_t)n;
+    }
+}
+
+static int client_connect(void) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un a;
+    memset(&a, 0, sizeof(a));
+    a.sun_family = AF_UNIX;
+    snprintf(a.sun_path, sizeof(a.sun_path), "%s", TEST_SOCKET);
+    for (int tries = 0; tries < 200; tries++) { // the server might still be starting
+        if (connect(fd, (struct sockaddr *)&a, sizeof(a)) == 0) return fd;
+        usleep(10000);
+    }
+    close(fd);
+    return -1;
+}
+
+// Our move in game 'cg' if it's our turn, or end it if it's gone on long enough
+static void client_play(Client *c, ClientGame *cg) {
+    char text[64];
+    if (cg->finished || cg->waiting || cg->g.turn != cg->human) return;
+    if (cg->plies >= TEST_MAX_PLIES) {
+        snprintf(text, sizeof(text), "end %d\n", cg->id);
+        client_send(c, text);
+        cg->waiting = 1;
+        return;
+    }
+    MoveList list;
+    generate_moves(&cg->g, &list);
+    Move m = list.moves[splitmix64(&c->rng) % (uint64_t)list.count];
+    char move[MOVE_TEXT_SIZE];
+    move_to_text(&m, move);
+    snprintf(text, sizeof(text), "move %d %s\n", cg->id, move);
+    client_send(c, text);
+    apply_move(&cg->g, &m);
+    switch_turn(&cg->g);
+    cg->plies++;
+    cg->waiting = 1;
+}
+
+static ClientGame *find_game(ClientGame *games, int id) {
+    for (int i = 0; i < TEST_GAMES_EACH; i++) if (games[i].id == id) return &games[i];
+    return NULL;
+}
+
+static void *client_thread(void *arg) {
+    Client *c = arg;
+    ClientGame games[TEST_GAMES_EACH];
+    char line[4096];
+    c->fd = client_connect();
+    if (c->fd < 0) { c->bad++; return NULL; }
+
+    for (int i = 0; i < TEST_GAMES_EACH; i++) {
+        memset(&games[i], 0, sizeof(games[i]));
+        games[i].id = -1;
+        games[i].human = i % 2; // half the games we're red, half black (engine moves first)
+        init_board(&games[i].g);
+    }
+
+    // An illegal move gets an error and changes nothing (in game 0 before anything else is going)
+    char text[64];
+    client_send(c, "new red depth 2\n");
+    if (!client_line(c, line, sizeof(line)) || sscanf(line, "game %d", &games[0].id) != 1) { c->bad++; return NULL; }
+    c->games++;
+    snprintf(text, sizeof(text), "move %d 9-18\nboard %d\n", games[0].id, games[0].id);
+    client_send(c, text);
+    if (!client_line(c, line, sizeof(line)) || strncmp(line, "error", 5) != 0) c->bad++;
+    if (!client_line(c, line, sizeof(line)) || strncmp(line, "board", 5) != 0 ||
+        strtoull(strchr(line + 6, ' ') + 3, NULL, 16) != games[0].g.red) c->bad++;
+
+    // The rest all at once - their "game" answers come in order, maybe with engine replies in between
+    for (int i = 1; i < TEST_GAMES_EACH; i++) client_send(c, games[i].human ? "new black depth 2\n" : "new red depth 2\n");
+    int next_new = 1;
+    client_play(c, &games[0]);
+    int open = TEST_GAMES_EACH;
+    while (open > 0 && client_line(c, line, sizeof(line))) {
+        int id;
+        char word[16], arg2[MOVE_TEXT_SIZE];
+        if (sscanf(line, "%15s %d %39s", word, &id, arg2) < 2) { c->bad++; break; }
+        if (strcmp(word, "game") == 0 && next_new < TEST_GAMES_EACH) {
+            ClientGame *cg = &games[next_new++];
+            cg->id = id;
+            cg->waiting = cg->human == 1;
+            c->games++;
+            client_play(c, cg);
+            continue;
+        }
+        ClientGame *cg = find_game(games, id);
+        if (!cg || cg->finished) { c->bad++; break; }
+        Move m;
+        if (strcmp(word, "reply") == 0) {
+            if (cg->g.turn == cg->human || !parse_move(&cg->g, arg2, &m)) { c->bad++; break; } // not legal here
+            apply_move(&cg->g, &m);
+            switch_turn(&cg->g);
+            cg->plies++;
+            cg->waiting = 0;
+            c->replies++;
+            MoveList list;
+            generate_moves(&cg->g, &list);
+            if (list.count == 0) { cg->waiting = 1; continue; } // "over" comes next
+        } else if (strcmp(word, "over") == 0) {
+            MoveList list;
+            generate_moves(&cg->g, &list);
+            const char *winner = cg->g.turn == 0 ? "black" : "red";
+            if (list.count != 0 || strcmp(arg2, winner) != 0) { c->bad++; break; }
+            cg->finished = 1;
+            open--;
+            c->overs++;
+            continue;
+        } else if (strcmp(word, "ended") == 0) {
+            cg->finished = 1;
+            open--;
+            continue;
+        } else { c->bad++; break; } // error, or something we never asked for
+        client_play(c, cg);
+    }
+    if (open > 0) c->bad++;
+    client_send(c, "quit\n");
+    close(c->fd);
+    return NULL;
+}
+
+/**
+ * A game ended (or dropped with its connection) while the engine is still thinking about it: its
+ * slot can't go to a new game before that search is done, or the new game gets the old reply too.
+ * Returns 1 if the next game only ever sees its own reply
+ */
+static int end_while_thinking(int drop) {
+    static Client c;
+    char line[512], text[64];
+    int old = -1, id = -1;
+    memset(&c, 0, sizeof(c));
+    c.fd = client_connect();
+    if (c.fd < 0) return 0;
+    client_send(&c, "new red depth 40 ms 300\n");
+    if (!client_line(&c, line, sizeof(line)) || sscanf(line, "game %d", &old) != 1) return 0;
+    snprintf(text, sizeof(text), "move %d 11-15\n", old);
+    client_send(&c, text); // the engine is thinking about its reply for the next 300 ms
+    if (drop) {
+        close(c.fd);
+        memset(&c, 0, sizeof(c));
+        c.fd = client_connect();
+        if (c.fd < 0) return 0;
+    } else {
+        snprintf(text, sizeof(text), "end %d\n", old);
+        client_send(&c, text);
+        if (!client_line(&c, line, sizeof(line)) || strncmp(line, "ended", 5) != 0) return 0;
+    }
+
+    client_send(&c, "new black depth 1\n");
+    int reply_id = -1;
+    char move[MOVE_TEXT_SIZE];
+    Move m;
+    GameState g;
+    init_board(&g);
+    int ok = client_line(&c, line, sizeof(line)) && sscanf(line, "game %d", &id) == 1 &&
+             client_line(&c, line, sizeof(line)) && sscanf(line, "reply %d %39s", &reply_id, move) == 2 &&
+             reply_id == id && parse_move(&g, move, &m);
+    if (ok) {
+        apply_move(&g, &m);
+        switch_turn(&g);
+        usleep(400000); // the old search is over by now, its reply must have gone nowhere
+        snprintf(text, sizeof(text), "board %d\n", id);
+        client_send(&c, text);
+        unsigned long long red = 0, black = 0;
+        char turn = 0;
+        ok = client_line(&c, line, sizeof(line)) && sscanf(line, "board %*d %c %llx %llx", &turn, &red, &black) == 3 &&
+             turn == 'b' && red == g.red && black == g.black;
+    }
+    client_send(&c, "quit\n");
+    close(c.fd);
+    return ok;
+}
+
+static void *server_thread(void *arg) {
+    *(int *)arg = server_run(&(ServerConfig){TEST_SOCKET, 0, 2, 1, 256, {2, 0, 1}});
+    return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int main() {
+    // --- Latency histogram vs exact percentiles ---
+    static uint64_t values[100000];
+    static LatencyHistogram h;
+    uint64_t rng = 12345;
+    for (int i = 0; i < 100000; i++) {
+        values[i] = splitmix64(&rng) % (1ULL << (splitmix64(&rng) % 30)); // spread over lots of powers of two
+        lat_record(&h, values[i] / 1000.0 + 0.0000001);
+    }
+    qsort(values, 100000, sizeof(values[0]), cmp_u64);
+    int hist_bad = 0;
+    double ps[] = {0.5, 0.9, 0.99, 0.999};
+    for (int i = 0; i < 4; i++) {
+        uint64_t exact = values[(int)(ps[i] * 100000)], got = lat_percentile(&h, ps[i]);
+        if (got > exact || got < exact - exact / 16) hist_bad++; // bucket floor, never more than 1/16 under
+    }
+    printf("Latency percentiles: %s\n", hist_bad ? "WRONG" : "ok");
+
+    // --- Server with clients ---
+    pthread_t server, clients[TEST_CLIENTS];
+    int server_rc = -1;
+    GameState keys;
+    init_board(&keys); // zobrist keys set up before the server and the clients all want them
+    pthread_create(&server, NULL, server_thread, &server_rc);
+    static Client c[TEST_CLIENTS];
+    double start = now_ms();
+    for (int i = 0; i < TEST_CLIENTS; i++) {
+        c[i].rng = 1000 + (uint64_t)i;
+        pthread_create(&clients[i], NULL, client_thread, &c[i]);
+    }
+    int games = 0, replies = 0, overs = 0, bad = 0;
+    for (int i = 0; i < TEST_CLIENTS; i++) {
+        pthread_join(clients[i], NULL);
+        games += c[i].games;
+        replies += c[i].replies;
+        overs += c[i].overs;
+        bad += c[i].bad;
+    }
+    double seconds = (now_ms() - start) / 1000;
+    printf("Clients: %d games, %d engine replies (%d games played out) in %.2f s, %d problems\n",
+           games, replies, overs, seconds, bad);
+
+    // Everyone's gone: no games left, and every reply counted once
+    Client s = {0};
+    char line[512] = "";
+    unsigned long long moves = 0;
+    int left = -1, stats_ok = 0;
+    s.fd = client_connect();
+    for (int tries = 0; s.fd >= 0 && tries < 100 && !stats_ok; tries++) { // the other hang-ups might not be seen yet
+        if (tries) usleep(10000);
+        client_send(&s, "stats\n");
+        stats_ok = client_line(&s, line, sizeof(line)) && sscanf(line, "stats games %d connections %*d moves %llu", &left, &moves) == 2 &&
+                   left == 0 && moves == (unsigned long long)replies;
+    }
+    if (s.fd >= 0) close(s.fd);
+    printf("Stats: %s\n%s\n", stats_ok ? "ok" : "WRONG", line);
+
+    int end_ok = end_while_thinking(0), drop_ok = end_while_thinking(1);
+    printf("Game ended while the engine thinks: %s, connection dropped: %s\n", end_ok ? "ok" : "WRONG", drop_ok ? "ok" : "WRONG");
+
+    server_stop();
+    pthread_join(server, NULL);
+    server_print_stats(stdout);
+
+    int failures = hist_bad + bad + !stats_ok + !end_ok + !drop_ok + (server_rc != 0) + (replies == 0);
+    printf("\n%s\n", failures ? "SERVER TESTS FAILED" : "All server tests passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,72 @@
+/**
+ * Zobrist hashing - one random 64 bit number per (board, square) plus one for the turn
+ *
+ * Included from checkers.c right after GameState so move_piece() and promote() can keep
+ * g->hash up to date as they go
+ *
+ * The hash of a position is the XOR of the numbers for every piece on the board (and the turn
+ * number if it's black's move). Since XOR undoes itself, moving a piece is just
+ *   hash ^= key[board][from] ^ key[board][to]
+ * and nobody ever has to look at all four boards again to get the hash
+ *
+ * Compile with -DCHECKERS_DEBUG to have every update checked against a full recompute
+ */
+
+enum { Z_RED = 0, Z_BLACK = 1, Z_RED_KINGS = 2, Z_BLACK_KINGS = 3 }; // same order as the GameState boards
+
+static uint64_t zobrist_keys[4][64];
+static uint64_t zobrist_turn;
+static int zobrist_ready = 0;
+
+// splitmix64 - tiny generator that gives well mixed 64 bit numbers, fixed seed so hashes are the same every run
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void init_zobrist(void) {
+    if (zobrist_ready) return;
+    uint64_t seed = 0x436865636B657273ULL; // "Checkers"
+    for (int b = 0; b < 4; b++)
+        for (int pos = 0; pos < 64; pos++) zobrist_keys[b][pos] = splitmix64(&seed);
+    zobrist_turn = splitmix64(&seed);
+    zobrist_ready = 1;
+}
+
+// XOR of the keys for every set bit in 'board'
+static uint64_t hash_board(uint64_t board, int which) {
+    uint64_t h = 0;
+    while (board) h ^= zobrist_keys[which][pop_lsb(&board)];
+    return h;
+}
+
+/**
+ * Full recompute from the four boards, only for setting up a position (init_board, loading one)
+ * and for the debug check - everything else updates g->hash incrementally
+ */
+uint64_t compute_hash(GameState *g) {
+    init_zobrist();
+    uint64_t h = hash_board(g->red, Z_RED) ^ hash_board(g->black, Z_BLACK)
+               ^ hash_board(g->red_kings, Z_RED_KINGS) ^ hash_board(g->black_kings, Z_BLACK_KINGS);
+    return g->turn ? h ^ zobrist_turn : h;
+}
+
+#ifdef CHECKERS_DEBUG
+// Debug build: make sure the incremental hash (and eval, see eval.c) never drifts from the real one
+#define CHECK_HASH(g) do { \
+        if ((g)->hash != compute_hash(g)) { \
+            fprintf(stderr, "Hash mismatch in %s: have %016llx, expected %016llx\n", __func__, \
+                    (unsigned long long)(g)->hash, (unsigned long long)compute_hash(g)); \
+            abort(); \
+        } \
+        if ((g)->eval != compute_eval(g)) { \
+            fprintf(stderr, "Eval mismatch in %s: have %d, expected %d\n", __func__, (g)->eval, compute_eval(g)); \
+            abort(); \
+        } \
+        NN_CHECK(g); \
+    } while (0)
+#else
+#define CHECK_HASH(g) ((void)0)
+#endif